@@ -0,0 +1,70 @@
+"""Time soundbox.qoa_encode on a real asset.
+
+    python benchmarks/qoa_encode.py music.ogg
+    python benchmarks/qoa_encode.py music.ogg --effort 4 --repeat 5
+
+The asset is decoded once with soundbox, then encoded with the SIMD search the
+module picked at import and again in a subprocess with SOUNDBOX_QOA_SCALAR=1.
+Both runs must produce the same bytes. Pass --scalar to only time the scalar
+search in this process.
+"""
+
+import argparse
+import hashlib
+import os
+import subprocess
+import sys
+import time
+
+
+def measure(path, effort, repeat):
+    import soundbox
+    import soundbox_core
+
+    pcm, samplerate, stereo = soundbox_core.load(path, soundbox)
+    pcm = bytes(pcm)
+    best = None
+    for _ in range(repeat):
+        start = time.perf_counter()
+        qoa = soundbox.qoa_encode(pcm, samplerate, stereo, effort=effort)
+        elapsed = time.perf_counter() - start
+        best = elapsed if best is None else min(best, elapsed)
+
+    seconds = len(pcm) / (2 * (2 if stereo else 1) * samplerate)
+    return best, seconds, hashlib.sha1(qoa).hexdigest()
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('path')
+    parser.add_argument('--effort', type=int, default=16)
+    parser.add_argument('--repeat', type=int, default=3)
+    parser.add_argument('--scalar', action='store_true')
+    parser.add_argument('--raw', action='store_true', help=argparse.SUPPRESS)
+    args = parser.parse_args()
+
+    if args.scalar:
+        os.environ['SOUNDBOX_QOA_SCALAR'] = '1'
+
+    elapsed, seconds, digest = measure(args.path, args.effort, args.repeat)
+    if args.raw:
+        print(elapsed, digest)
+        return
+
+    label = 'scalar' if args.scalar else 'default'
+    print(f'{label:8} {elapsed * 1000:9.1f} ms  {seconds / elapsed:7.1f}x realtime  {digest[:12]}')
+    if args.scalar:
+        return
+
+    cmd = [sys.executable, __file__, args.path, '--effort', str(args.effort), '--repeat', str(args.repeat), '--raw']
+    env = dict(os.environ, SOUNDBOX_QOA_SCALAR='1')
+    scalar, scalar_digest = subprocess.check_output(cmd, env=env, text=True).split()
+    scalar = float(scalar)
+    print(f'{"scalar":8} {scalar * 1000:9.1f} ms  {seconds / scalar:7.1f}x realtime  {scalar_digest[:12]}')
+    print(f'speedup  {scalar / elapsed:.2f}x')
+    if scalar_digest != digest:
+        sys.exit('scalar and SIMD output differ')
+
+
+if __name__ == '__main__':
+    main()
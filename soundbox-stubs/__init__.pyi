@@ -1,9 +1,16 @@
-from typing import Tuple
+from typing import Any, Callable, Dict, List, Sequence, Tuple
 
 Vec3 = Tuple[float, float, float]
 
 class Buffer: ...
 
+class Task:
+    name: str
+    done: bool
+    error: str | None
+
+    def wait(self) -> None: ...
+
 class Source:
     ended: bool
 
@@ -11,12 +18,87 @@ class Source:
     def pause(self) -> None: ...
     def resume(self) -> None: ...
 
-def init() -> None: ...
+class Stream:
+    ended: bool
+
+    def stop(self) -> None: ...
+    def pause(self) -> None: ...
+    def resume(self) -> None: ...
+
+class OggStream:
+    samplerate: int
+    channels: int
+    samples: int
+    position: int
+
+    def read(self, out: Any) -> int: ...
+    def seek(self, sample: int) -> None: ...
+
+class QoaStream:
+    samplerate: int
+    channels: int
+    samples: int
+    position: int
+
+    def read(self, out: Any) -> int: ...
+    def seek(self, sample: int) -> None: ...
+
+def init(sources: int = 256, cache_budget: int = 0, cache_dir: str | None = None) -> None: ...
 def update(position: Vec3, velocity: Vec3, direction: Vec3, up: Vec3, gain: float) -> None: ...
 def pause() -> None: ...
 def resume() -> None: ...
+def cache_stats() -> Dict[str, int]: ...
 def load(name: str, data: bytes | str | tuple) -> None: ...
+def load_async(name: str, data: bytes | str, callback: Callable[[Task], None] | None = None) -> Task: ...
+def load_bank(path: str) -> List[str]: ...
+def load_many(items: Dict[str, bytes | str] | str, threads: int = 1) -> Dict[str, str]: ...
+def register(name: str, data: bytes | str, lazy: bool = True) -> None: ...
+def prefetch(names: Sequence[str | Buffer]) -> None: ...
 def unload(name: str) -> None: ...
 def play(
-    name: str, position: Vec3, velocity: Vec3, direction: Vec3, pitch: float, gain: float, relative: bool, loop: bool
+    name: str,
+    position: Vec3,
+    velocity: Vec3,
+    direction: Vec3,
+    pitch: float,
+    gain: float,
+    relative: bool,
+    loop: bool,
+    priority: int = 0,
 ) -> Source: ...
+def play_many(
+    names: Sequence[str | Buffer],
+    positions: Any = None,
+    velocities: Any = None,
+    directions: Any = None,
+    pitches: Any = None,
+    gains: Any = None,
+    relative: bool = False,
+    loop: bool = False,
+    priority: int = 0,
+) -> Tuple[Source, ...]: ...
+def set_positions(sources: Sequence[Source], positions: Any) -> None: ...
+def set_params(
+    sources: Sequence[Source], positions: Any = None, velocities: Any = None, pitches: Any = None, gains: Any = None
+) -> None: ...
+def stream(
+    name_or_path: Buffer | bytes | str,
+    position: Vec3 = (0.0, 0.0, 0.0),
+    velocity: Vec3 = (0.0, 0.0, 0.0),
+    pitch: float = 1.0,
+    gain: float = 1.0,
+    relative: bool = True,
+    loop: bool = False,
+    priority: int = 0,
+) -> Stream: ...
+def qoa_encode(
+    data: bytes,
+    samplerate: int = 44100,
+    stereo: bool = False,
+    effort: int = 16,
+    report_error: bool = False,
+    segments: int = 1,
+    threads: int = 1,
+) -> bytes | Tuple[bytes, float]: ...
+def ogg_stream(data: bytes) -> OggStream: ...
+def qoa_stream(data: bytes) -> QoaStream: ...
@@ -1,9 +1,11 @@
 #include <Windows.h>
+#include <intrin.h>
 
 #include <Python.h>
 #include <structmember.h>
 
 #define QOA_NO_STDIO
+#define QOA_RECORD_TOTAL_ERROR
 #define QOA_IMPLEMENTATION
 #include "qoa.h"
 
@@ -29,15 +31,21 @@ struct ALCcontext;
 #define AL_PLAYING 0x1012
 #define AL_PAUSED 0x1013
 #define AL_STOPPED 0x1014
+#define AL_BUFFERS_QUEUED 0x1015
+#define AL_BUFFERS_PROCESSED 0x1016
 #define AL_FORMAT_MONO16 0x1101
 #define AL_FORMAT_STEREO16 0x1103
 #define AL_SOURCE_RELATIVE 0x202
 #define AL_LOOPING 0x1007
+#define AL_EVENT_TYPE_SOURCE_STATE_CHANGED_SOFT 0x19A5
 
 static ALCcontext * (* alcCreateContext)(ALCdevice * device, const int * attrlist);
 static char (* alcMakeContextCurrent)(ALCcontext * context);
 static ALCdevice * (* alcOpenDevice)(const char * devicename);
 static char (* alcCloseDevice)(ALCdevice * device);
+static void (* alcDestroyContext)(ALCcontext * context);
+static void (* alcSuspendContext)(ALCcontext * context);
+static void (* alcProcessContext)(ALCcontext * context);
 
 static void (* alListenerfv)(int param, const float * values);
 static void (* alListenerf)(int param, float value);
@@ -57,23 +65,242 @@ static void (* alGetSourcei)(int source, int param, int * value);
 static void (* alSourcePlay)(int source);
 static void (* alSourceStop)(int source);
 static void (* alSourcePause)(int source);
+static void (* alSourceQueueBuffers)(int source, int n, const int * buffers);
+static void (* alSourceUnqueueBuffers)(int source, int n, int * buffers);
 
-// static void (* alSourcePlayv)(int n, const int * sources);
+static char (* alIsExtensionPresent)(const char * extname);
+static void * (* alGetProcAddress)(const char * fname);
+static void (* alEventControlSOFT)(int count, const int * types, char enable);
+static void (* alDeferUpdatesSOFT)();
+static void (* alProcessUpdatesSOFT)();
+static void (* alEventCallbackSOFT)(void (* callback)(int, unsigned, unsigned, int, const char *, void *), void * user);
+
+static void (* alSourcePlayv)(int n, const int * sources);
 // static void (* alSourcePausev)(int n, const int * sources);
 
+enum BufferState {
+    BUFFER_COLD,
+    BUFFER_LOADING,
+    BUFFER_READY,
+};
+
 struct Buffer {
     PyObject_HEAD
+    Buffer * next;
+    Buffer * lru_prev;
+    Buffer * lru_next;
+    bool cached;
+    int voices;
+    Buffer * hash_next;
+    unsigned long long hash;
+    unsigned long long check;
+    int hash_size;
+    bool hashed;
+    SRWLOCK lock;
+    volatile LONG state;
     int buffer;
     int size;
     int samplerate;
     int stereo;
+    const unsigned char * data;
+    int data_size;
+    PyObject * owner;
+    wchar_t * path;
 };
 
 struct Source {
     PyObject_HEAD
-    Source * next;
-    Buffer * buffer;
+    int voice;
+};
+
+struct Task {
+    PyObject_HEAD
+    Task * next;
+    PyObject * name;
+    PyObject * data;
+    PyObject * callback;
+    wchar_t * path;
+    Py_buffer view;
+    HANDLE event;
+    volatile LONG done;
+    bool finished;
+    const char * error;
+    int buffer;
+    int size;
+    int samplerate;
+    int stereo;
+};
+
+struct FileMap {
+    HANDLE file;
+    HANDLE mapping;
+    const unsigned char * data;
+    int size;
+};
+
+struct Bank {
+    PyObject_HEAD
+    FileMap file;
+};
+
+struct BankHeader {
+    char magic[4];
+    unsigned int version;
+    unsigned int count;
+    unsigned int names_size;
+};
+
+struct BankEntry {
+    unsigned int name_offset;
+    unsigned int name_length;
+    unsigned int offset;
+    unsigned int length;
+    unsigned int codec;
+    unsigned int samplerate;
+    unsigned int channels;
+    unsigned int reserved;
+};
+
+struct Decoder {
+    const unsigned char * data;
+    unsigned int size;
+    int samplerate;
+    int channels;
+    unsigned int samples;
+    unsigned int position;
+    stb_vorbis * vorbis;
+    qoa_desc qoa;
+    unsigned int * frames;
+    unsigned int num_frames;
+    unsigned int next_frame;
+    short * frame;
+    unsigned int frame_len;
+    unsigned int frame_pos;
+};
+
+struct DecodeStream {
+    PyObject_HEAD
+    PyObject * data;
+    Py_buffer view;
+    Decoder decoder;
+    bool busy;
+};
+
+#define STREAM_BUFFERS 4
+#define PCM_CACHE_VERSION 1
+#define PCM_CACHE_HEADER 4096
+
+struct Stream {
+    PyObject_HEAD
+    Stream * next;
+    PyObject * data;
+    Py_buffer view;
+    FileMap file;
+    Decoder decoder;
     int source;
+    int buffers[STREAM_BUFFERS];
+    int idle[STREAM_BUFFERS];
+    int idle_count;
+    short * chunk;
+    int chunk_samples;
+    int state;
+    bool loop;
+    bool eof;
+    volatile LONG ended;
+};
+
+struct ParallelFor {
+    void (* func)(void * arg, int index);
+    void * arg;
+    int count;
+    volatile LONG next;
+};
+
+struct QoaFrames {
+    const unsigned char * bytes;
+    unsigned int * offsets;
+    unsigned int * lengths;
+    unsigned int size;
+    qoa_desc qoa;
+    short * samples;
+};
+
+struct QoaEncode {
+    const short * samples;
+    const qoa_desc * qoa;
+    int effort;
+    unsigned int segment_frames;
+    unsigned char * bytes;
+    qoa_uint64_t * error;
+};
+
+struct QoaSlice {
+    qoa_uint64_t slice;
+    qoa_uint64_t rank;
+    qoa_uint64_t error;
+    qoa_lms_t lms;
+    int scalefactor;
+};
+
+typedef void (* QoaSearch)(const short * samples, int channels, int len, const qoa_lms_t * lms, int prev_scalefactor, QoaSlice * best);
+typedef void (* QoaSearchLanes)(const short * samples, int channels, int len, const qoa_lms_t * lms, int prev_scalefactor, const int * candidates, int count, QoaSlice * best);
+
+struct Pcm {
+    short * samples;
+    int size;
+    int samplerate;
+    int channels;
+    FileMap file;
+};
+
+struct LoadItem {
+    PyObject * name;
+    wchar_t * path;
+    Py_buffer view;
+    FileMap file;
+    const unsigned char * data;
+    int size;
+    unsigned long long hash;
+    unsigned long long check;
+    Buffer * shared;
+    Pcm pcm;
+    const char * error;
+};
+
+struct PcmCacheHeader {
+    char magic[4];
+    unsigned int version;
+    unsigned int input_size;
+    unsigned int size;
+    unsigned int samplerate;
+    unsigned int channels;
+};
+
+struct Voices {
+    int count;
+    int * source;
+    Buffer ** buffer;
+    Source ** object;
+    int * state;
+    int * priority;
+};
+
+struct EventQueue {
+    int * items;
+    LONG mask;
+    volatile LONG head;
+    volatile LONG tail;
+    volatile LONG overflow;
+};
+
+struct BufferCache {
+    Buffer * head;
+    Buffer * tail;
+    long long bytes;
+    long long budget;
+    long long hits;
+    long long misses;
+    long long evictions;
 };
 
 struct Listener {
@@ -85,98 +312,1700 @@ struct Listener {
 
 static PyTypeObject * Buffer_type;
 static PyTypeObject * Source_type;
+static PyTypeObject * Task_type;
+static PyTypeObject * Stream_type;
+static PyTypeObject * Bank_type;
+static PyTypeObject * OggStream_type;
+static PyTypeObject * QoaStream_type;
 
 static PyObject * helper;
 static PyObject * buffers;
 
 static ALCdevice * device;
 static ALCcontext * context;
-static Source * playing;
+static Voices voices;
+
+static int * source_pool;
+static int source_pool_size;
+static int source_pool_free;
+
+static int * source_keys;
+static int * source_voices;
+static int source_mask;
+
+static bool use_events;
+static EventQueue stopped;
+
+static int batch_depth;
+
+static QoaSearch qoa_search;
+static QoaSearchLanes qoa_search_lanes8;
+static QoaSearchLanes qoa_search_lanes16;
 
+static SRWLOCK completed_lock = SRWLOCK_INIT;
+static Task * completed;
+static Buffer * prefetched;
+
+static SRWLOCK stream_lock = SRWLOCK_INIT;
+static Stream * streams;
+static HANDLE stream_thread;
+static HANDLE stream_wake;
+static volatile LONG stream_quit;
+
+static BufferCache cache;
+
+static Buffer ** buffer_table;
+static int buffer_table_mask;
+static int buffer_table_count;
+
+static wchar_t * pcm_cache_dir;
 static Listener listener;
 
+static void CALLBACK parallel_worker(PTP_CALLBACK_INSTANCE instance, void * arg, PTP_WORK work) {
+    ParallelFor * job = (ParallelFor *)arg;
+    int index;
+    while ((index = InterlockedIncrement(&job->next) - 1) < job->count) {
+        job->func(job->arg, index);
+    }
+}
+
+static void parallel_for(int count, int threads, void (* func)(void * arg, int index), void * arg) {
+    ParallelFor job = {func, arg, count, 0};
+    PTP_WORK work = threads > 1 && count > 1 ? CreateThreadpoolWork(parallel_worker, &job, NULL) : NULL;
+    if (!work) {
+        parallel_worker(NULL, &job, NULL);
+        return;
+    }
+    for (int i = 0; i < threads && i < count; ++i) {
+        SubmitThreadpoolWork(work);
+    }
+    WaitForThreadpoolWorkCallbacks(work, false);
+    CloseThreadpoolWork(work);
+}
+
+/* Frames are decoded to fixed offsets and qoa_decode_frame() trusts the frame
+size. A frame claiming more samples than fit there, too small for its samples,
+past the end of the data or with other channels than the file is invalid. */
+
+static bool qoa_frame_valid(const unsigned char * bytes, unsigned int size, unsigned int channels, unsigned int max_samples) {
+    unsigned int frame_samples = (bytes[4] << 8) | bytes[5];
+    unsigned int frame_size = (bytes[6] << 8) | bytes[7];
+    unsigned int slices = (frame_samples + QOA_SLICE_LEN - 1) / QOA_SLICE_LEN;
+    if (frame_samples > QOA_FRAME_LEN || frame_samples > max_samples) {
+        return false;
+    }
+    return frame_size >= QOA_FRAME_SIZE(channels, slices) && frame_size <= size && bytes[0] == channels;
+}
+
+/* Frame sizes are stored in the frame headers, so the frame offsets can be
+found without decoding anything. A truncated file ends at its last complete
+frame like qoa.h, any other invalid frame makes the whole file invalid. */
+
+static int qoa_index_frames(const unsigned char * bytes, unsigned int size, unsigned int p, unsigned int channels, unsigned int total_samples, unsigned int * offsets, unsigned int max_frames) {
+    unsigned int num_frames = 0;
+    while (num_frames < max_frames && p + 8 <= size) {
+        unsigned int frame_size = (bytes[p + 6] << 8) | bytes[p + 7];
+        if (!frame_size || frame_size > size - p) {
+            break;
+        }
+        if (!qoa_frame_valid(bytes + p, size - p, channels, total_samples - num_frames * QOA_FRAME_LEN)) {
+            return -1;
+        }
+        offsets[num_frames++] = p;
+        p += frame_size;
+    }
+    return num_frames;
+}
+
+static void qoa_decode_frame_job(void * arg, int index) {
+    QoaFrames * frames = (QoaFrames *)arg;
+    qoa_desc qoa = frames->qoa;
+    unsigned int offset = frames->offsets[index];
+    short * sample_ptr = frames->samples + index * QOA_FRAME_LEN * qoa.channels;
+    qoa_decode_frame(frames->bytes + offset, frames->size - offset, &qoa, sample_ptr, &frames->lengths[index]);
+}
+
+static int qoa_decode_parallel(const unsigned char * bytes, int size, unsigned int p, const qoa_desc * qoa, short * output, int threads) {
+    int max_frames = (qoa->samples + QOA_FRAME_LEN - 1) / QOA_FRAME_LEN;
+    QoaFrames frames = {bytes, NULL, NULL, (unsigned int)size, *qoa, output};
+    frames.offsets = (unsigned int *)malloc(max_frames * sizeof(unsigned int));
+    frames.lengths = (unsigned int *)calloc(max_frames, sizeof(unsigned int));
+
+    int num_frames = qoa_index_frames(bytes, size, p, qoa->channels, qoa->samples, frames.offsets, max_frames);
+    if (num_frames < 0) {
+        free(frames.offsets);
+        free(frames.lengths);
+        return -1;
+    }
+
+    parallel_for(num_frames, threads, qoa_decode_frame_job, &frames);
+
+    unsigned int sample_index = 0;
+    for (int i = 0; i < num_frames && frames.lengths[i]; ++i) {
+        sample_index += frames.lengths[i];
+        if (frames.lengths[i] != QOA_FRAME_LEN) {
+            break;
+        }
+    }
+
+    free(frames.offsets);
+    free(frames.lengths);
+    return sample_index;
+}
+
+/* Encodes one slice with the given scalefactor, same as the inner loop of
+qoa_encode_frame(), and stores it in res if it ranks better than best_rank.
+Gives up as soon as the rank exceeds best_rank. */
+
+static void qoa_try_scalefactor(const short * samples, int channels, int len, const qoa_lms_t * lms, int scalefactor, qoa_uint64_t best_rank, QoaSlice * res) {
+    qoa_lms_t current_lms = *lms;
+    qoa_uint64_t slice = scalefactor;
+    qoa_uint64_t current_rank = 0;
+    qoa_uint64_t current_error = 0;
+
+    for (int si = 0; si < len * channels; si += channels) {
+        int sample = samples[si];
+        int predicted = qoa_lms_predict(&current_lms);
+
+        int residual = sample - predicted;
+        int scaled = qoa_div(residual, scalefactor);
+        int clamped = qoa_clamp(scaled, -8, 8);
+        int quantized = qoa_quant_tab[clamped + 8];
+        int dequantized = qoa_dequant_tab[scalefactor][quantized];
+        int reconstructed = qoa_clamp_s16(predicted + dequantized);
+
+        int weights_penalty = ((
+            current_lms.weights[0] * current_lms.weights[0] +
+            current_lms.weights[1] * current_lms.weights[1] +
+            current_lms.weights[2] * current_lms.weights[2] +
+            current_lms.weights[3] * current_lms.weights[3]
+        ) >> 18) - 0x8ff;
+        if (weights_penalty < 0) {
+            weights_penalty = 0;
+        }
+
+        long long error = (sample - reconstructed);
+        qoa_uint64_t error_sq = error * error;
+
+        current_rank += error_sq + weights_penalty * weights_penalty;
+        current_error += error_sq;
+        if (current_rank > best_rank) {
+            return;
+        }
+
+        qoa_lms_update(&current_lms, reconstructed, dequantized);
+        slice = (slice << 3) | quantized;
+    }
+
+    if (current_rank < best_rank) {
+        res->slice = slice;
+        res->rank = current_rank;
+        res->error = current_error;
+        res->lms = current_lms;
+        res->scalefactor = scalefactor;
+    }
+}
+
+/* Same search as qoa_encode_frame(): try all 16 scalefactors starting with the
+previous one and keep the first with the lowest rank. */
+
+static void qoa_search_scalar(const short * samples, int channels, int len, const qoa_lms_t * lms, int prev_scalefactor, QoaSlice * best) {
+    best->rank = -1;
+    for (int sfi = 0; sfi < 16; sfi++) {
+        int scalefactor = (sfi + prev_scalefactor) % 16;
+        qoa_try_scalefactor(samples, channels, len, lms, scalefactor, best->rank, best);
+    }
+}
+
+struct Sse41 {
+    typedef __m128i reg;
+    enum { lanes = 4 };
+    static reg zero() { return _mm_setzero_si128(); }
+    static reg set1(int x) { return _mm_set1_epi32(x); }
+    static reg load(const void * ptr) { return _mm_loadu_si128((const reg *)ptr); }
+    static void store(void * ptr, reg x) { _mm_storeu_si128((reg *)ptr, x); }
+    static reg add(reg a, reg b) { return _mm_add_epi32(a, b); }
+    static reg sub(reg a, reg b) { return _mm_sub_epi32(a, b); }
+    static reg mul(reg a, reg b) { return _mm_mullo_epi32(a, b); }
+    static reg sra(reg a, int n) { return _mm_srai_epi32(a, n); }
+    static reg min(reg a, reg b) { return _mm_min_epi32(a, b); }
+    static reg max(reg a, reg b) { return _mm_max_epi32(a, b); }
+    static reg abs(reg a) { return _mm_abs_epi32(a); }
+    static reg band(reg a, reg b) { return _mm_and_si128(a, b); }
+    static reg gt(reg a, reg b) { return _mm_cmpgt_epi32(a, b); }
+    static reg eq(reg a, reg b) { return _mm_cmpeq_epi32(a, b); }
+    static reg select(reg a, reg b, reg mask) { return _mm_blendv_epi8(a, b, mask); }
+    static reg add64(reg a, reg b) { return _mm_add_epi64(a, b); }
+    static reg widen_lo(reg a) { return _mm_cvtepu32_epi64(a); }
+    static reg widen_hi(reg a) { return _mm_cvtepu32_epi64(_mm_srli_si128(a, 8)); }
+};
+
+struct Avx2 {
+    typedef __m256i reg;
+    enum { lanes = 8 };
+    static reg zero() { return _mm256_setzero_si256(); }
+    static reg set1(int x) { return _mm256_set1_epi32(x); }
+    static reg load(const void * ptr) { return _mm256_loadu_si256((const reg *)ptr); }
+    static void store(void * ptr, reg x) { _mm256_storeu_si256((reg *)ptr, x); }
+    static reg add(reg a, reg b) { return _mm256_add_epi32(a, b); }
+    static reg sub(reg a, reg b) { return _mm256_sub_epi32(a, b); }
+    static reg mul(reg a, reg b) { return _mm256_mullo_epi32(a, b); }
+    static reg sra(reg a, int n) { return _mm256_srai_epi32(a, n); }
+    static reg min(reg a, reg b) { return _mm256_min_epi32(a, b); }
+    static reg max(reg a, reg b) { return _mm256_max_epi32(a, b); }
+    static reg abs(reg a) { return _mm256_abs_epi32(a); }
+    static reg band(reg a, reg b) { return _mm256_and_si256(a, b); }
+    static reg gt(reg a, reg b) { return _mm256_cmpgt_epi32(a, b); }
+    static reg eq(reg a, reg b) { return _mm256_cmpeq_epi32(a, b); }
+    static reg select(reg a, reg b, reg mask) { return _mm256_blendv_epi8(a, b, mask); }
+    static reg add64(reg a, reg b) { return _mm256_add_epi64(a, b); }
+    static reg widen_lo(reg a) { return _mm256_cvtepu32_epi64(_mm256_castsi256_si128(a)); }
+    static reg widen_hi(reg a) { return _mm256_cvtepu32_epi64(_mm256_extracti128_si256(a, 1)); }
+};
+
+/* Vectorized qoa_search_scalar(): lane i encodes the slice with scalefactor
+candidates[i], lanes past count repeat the last candidate. Every lane runs to
+the end of the slice, the early break of the scalar search only skips
+candidates that can not win, so the result is bit-exact with trying the same
+candidates in the scalar search order. */
+
+template <typename V, int regs>
+static void qoa_search_lanes(const short * samples, int channels, int len, const qoa_lms_t * lms, int prev_scalefactor, const int * candidates, int count, QoaSlice * best) {
+    typedef typename V::reg reg;
+
+    int table[16];
+    qoa_uint64_t ranks[16];
+    int quantized[QOA_SLICE_LEN][16];
+    unsigned errors[QOA_SLICE_LEN][16];
+    int history[QOA_LMS_LEN][16];
+    int weights[QOA_LMS_LEN][16];
+
+    reg h[QOA_LMS_LEN][regs];
+    reg w[QOA_LMS_LEN][regs];
+    reg reciprocal[regs];
+    reg dequant[4][regs];
+    reg rank[2][regs];
+
+    for (int r = 0; r < regs; ++r) {
+        for (int i = 0; i < QOA_LMS_LEN; ++i) {
+            h[i][r] = V::set1(lms->history[i]);
+            w[i][r] = V::set1(lms->weights[i]);
+        }
+        for (int k = 0; k < V::lanes; ++k) {
+            table[k] = qoa_reciprocal_tab[candidates[qoa_clamp(r * V::lanes + k, 0, count - 1)]];
+        }
+        reciprocal[r] = V::load(table);
+        for (int m = 0; m < 4; ++m) {
+            for (int k = 0; k < V::lanes; ++k) {
+                table[k] = qoa_dequant_tab[candidates[qoa_clamp(r * V::lanes + k, 0, count - 1)]][m * 2];
+            }
+            dequant[m][r] = V::load(table);
+        }
+        rank[0][r] = V::zero();
+        rank[1][r] = V::zero();
+    }
+
+    const reg zero = V::zero();
+    const reg one = V::set1(1);
+    for (int n = 0; n < len; ++n) {
+        const reg sample = V::set1(samples[n * channels]);
+        for (int r = 0; r < regs; ++r) {
+            reg predicted = V::sra(V::add(
+                V::add(V::mul(w[0][r], h[0][r]), V::mul(w[1][r], h[1][r])),
+                V::add(V::mul(w[2][r], h[2][r]), V::mul(w[3][r], h[3][r]))
+            ), 13);
+
+            reg residual = V::sub(sample, predicted);
+            reg scaled = V::sra(V::add(V::mul(residual, reciprocal[r]), V::set1(1 << 15)), 16);
+            reg rounding = V::sub(V::sub(V::gt(zero, residual), V::gt(residual, zero)), V::sub(V::gt(zero, scaled), V::gt(scaled, zero)));
+            scaled = V::add(scaled, rounding);
+            reg clamped = V::min(V::max(scaled, V::set1(-8)), V::set1(8));
+
+            reg negative = V::gt(zero, clamped);
+            reg index = V::min(V::sra(V::abs(clamped), 1), V::set1(3));
+            reg quant = V::add(V::add(index, index), V::band(negative, one));
+
+            reg dequantized = dequant[0][r];
+            dequantized = V::select(dequantized, dequant[1][r], V::eq(index, one));
+            dequantized = V::select(dequantized, dequant[2][r], V::eq(index, V::set1(2)));
+            dequantized = V::select(dequantized, dequant[3][r], V::eq(index, V::set1(3)));
+            dequantized = V::select(dequantized, V::sub(zero, dequantized), negative);
+
+            reg reconstructed = V::min(V::max(V::add(predicted, dequantized), V::set1(-32768)), V::set1(32767));
+
+            reg penalty = V::sra(V::add(
+                V::add(V::mul(w[0][r], w[0][r]), V::mul(w[1][r], w[1][r])),
+                V::add(V::mul(w[2][r], w[2][r]), V::mul(w[3][r], w[3][r]))
+            ), 18);
+            penalty = V::max(V::sub(penalty, V::set1(0x8ff)), zero);
+
+            reg error = V::sub(sample, reconstructed);
+            reg error_sq = V::mul(error, error);
+            reg penalty_sq = V::mul(penalty, penalty);
+            rank[0][r] = V::add64(rank[0][r], V::add64(V::widen_lo(error_sq), V::widen_lo(penalty_sq)));
+            rank[1][r] = V::add64(rank[1][r], V::add64(V::widen_hi(error_sq), V::widen_hi(penalty_sq)));
+            V::store(errors[n] + r * V::lanes, error_sq);
+            V::store(quantized[n] + r * V::lanes, quant);
+
+            reg delta = V::sra(dequantized, 4);
+            for (int i = 0; i < QOA_LMS_LEN; ++i) {
+                w[i][r] = V::add(w[i][r], V::select(delta, V::sub(zero, delta), V::gt(zero, h[i][r])));
+            }
+            for (int i = 0; i < QOA_LMS_LEN - 1; ++i) {
+                h[i][r] = h[i + 1][r];
+            }
+            h[QOA_LMS_LEN - 1][r] = reconstructed;
+        }
+    }
+
+    for (int r = 0; r < regs; ++r) {
+        V::store(ranks + r * V::lanes, rank[0][r]);
+        V::store(ranks + r * V::lanes + V::lanes / 2, rank[1][r]);
+        for (int i = 0; i < QOA_LMS_LEN; ++i) {
+            V::store(history[i] + r * V::lanes, h[i][r]);
+            V::store(weights[i] + r * V::lanes, w[i][r]);
+        }
+    }
+
+    int lanes[16];
+    for (int i = 0; i < 16; ++i) {
+        lanes[i] = -1;
+    }
+    for (int i = count - 1; i >= 0; --i) {
+        lanes[candidates[i]] = i;
+    }
+
+    int lane = -1;
+    for (int sfi = 0; sfi < 16; sfi++) {
+        int candidate = lanes[(sfi + prev_scalefactor) % 16];
+        if (candidate >= 0 && (lane < 0 || ranks[candidate] < ranks[lane])) {
+            lane = candidate;
+        }
+    }
+
+    best->scalefactor = candidates[lane];
+    best->slice = candidates[lane];
+    best->rank = ranks[lane];
+    best->error = 0;
+    for (int n = 0; n < len; ++n) {
+        best->slice = (best->slice << 3) | quantized[n][lane];
+        best->error += errors[n][lane];
+    }
+    for (int i = 0; i < QOA_LMS_LEN; ++i) {
+        best->lms.history[i] = history[i][lane];
+        best->lms.weights[i] = weights[i][lane];
+    }
+}
+
+template <typename V>
+static void qoa_search_simd(const short * samples, int channels, int len, const qoa_lms_t * lms, int prev_scalefactor, QoaSlice * best) {
+    static const int all[16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+    qoa_search_lanes<V, 16 / V::lanes>(samples, channels, len, lms, prev_scalefactor, all, 16, best);
+}
+
+/* Tries the scalefactors in mask and keeps the first one with the lowest rank
+in the scalar search order, so every instruction set picks the same one. */
+
+static void qoa_search_mask(const short * samples, int channels, int len, const qoa_lms_t * lms, int prev_scalefactor, int mask, QoaSlice * best) {
+    int candidates[16];
+    int count = 0;
+    for (int sf = 0; sf < 16; ++sf) {
+        if (mask & (1 << sf)) {
+            candidates[count++] = sf;
+        }
+    }
+    if (qoa_search_lanes8) {
+        QoaSearchLanes search = count <= 8 ? qoa_search_lanes8 : qoa_search_lanes16;
+        search(samples, channels, len, lms, prev_scalefactor, candidates, count, best);
+        return;
+    }
+    best->rank = -1;
+    for (int sfi = 0; sfi < 16; sfi++) {
+        int scalefactor = (sfi + prev_scalefactor) % 16;
+        if (mask & (1 << scalefactor)) {
+            qoa_try_scalefactor(samples, channels, len, lms, scalefactor, best->rank, best);
+        }
+    }
+}
+
+/* Reduced effort search: a window of effort + 1 scalefactors around the
+previous one plus a coarse grid over the whole range, then keep trying the untested
+neighbours of the best one until none of them wins. The grid catches jumps in
+amplitude the local walk would get stuck on, a slice that still ranks much
+worse than the previous one gets the full search. The candidates only depend
+on effort, so the output is the same on every machine.
+
+Every candidate is a serial pass over the slice, so the search is bound by
+latency, not by how many candidates it tries. The SIMD search evaluates all
+16 candidates in about 1.6 times the cost of one 8-lane pass, and a window
+that fits in 8 lanes is one pass plus its walk. Measured on stereo music:
+effort 4 (5 + grid candidates, one pass) is about 1.4x faster than effort 16
+and adds about 0.1% squared error. Below 4 the window stops saving passes,
+the walk adds them back and quality drops by up to 1%, so effort 0 can be
+slower than 16. The scalar search gains 1.2x to 1.4x across efforts 0 to 4. */
+
+#define QOA_SEARCH_GRID 0x8421
+
+static void qoa_search_window(const short * samples, int channels, int len, const qoa_lms_t * lms, const QoaSlice * prev, int effort, QoaSlice * best) {
+    int lo = prev->scalefactor - effort / 2;
+    int mask = QOA_SEARCH_GRID;
+    for (int sf = qoa_clamp(lo, 0, 15); sf <= qoa_clamp(lo + effort, 0, 15); ++sf) {
+        mask |= 1 << sf;
+    }
+    qoa_search_mask(samples, channels, len, lms, prev->scalefactor, mask, best);
+
+    for (;;) {
+        int sf = best->scalefactor;
+        int next = sf < 15 && !(mask & (1 << (sf + 1))) ? sf + 1 : sf > 0 && !(mask & (1 << (sf - 1))) ? sf - 1 : -1;
+        if (next < 0) {
+            break;
+        }
+        mask |= 1 << next;
+        qoa_try_scalefactor(samples, channels, len, lms, next, best->rank, best);
+    }
+
+    if (mask != 0xffff && best->rank > prev->rank * 4 + len * 1024) {
+        qoa_search(samples, channels, len, lms, prev->scalefactor, best);
+    }
+}
+
+/* SOUNDBOX_QOA_SCALAR forces the scalar search, benchmarks use it to compare
+against the SIMD paths, which produce the same bytes. */
+
+static QoaSearch qoa_search_detect() {
+    int info[4] = {};
+    __cpuid(info, 0);
+    int max_leaf = info[0];
+    qoa_search_lanes8 = NULL;
+    qoa_search_lanes16 = NULL;
+
+    const char * scalar = getenv("SOUNDBOX_QOA_SCALAR");
+    if (scalar && *scalar && strcmp(scalar, "0")) {
+        return qoa_search_scalar;
+    }
+
+    __cpuid(info, 1);
+    bool sse41 = (info[2] >> 19) & 1;
+    bool avx = ((info[2] >> 27) & 1) && ((info[2] >> 28) & 1) && (_xgetbv(0) & 6) == 6;
+
+    __cpuidex(info, 7, 0);
+    bool avx2 = avx && max_leaf >= 7 && ((info[1] >> 5) & 1);
+
+    if (avx2) {
+        qoa_search_lanes8 = qoa_search_lanes<Avx2, 1>;
+        qoa_search_lanes16 = qoa_search_lanes<Avx2, 2>;
+        return qoa_search_simd<Avx2>;
+    }
+    if (sse41) {
+        qoa_search_lanes8 = qoa_search_lanes<Sse41, 2>;
+        qoa_search_lanes16 = qoa_search_lanes<Sse41, 4>;
+        return qoa_search_simd<Sse41>;
+    }
+    return qoa_search_scalar;
+}
+
+/* Every channel has its own lms state and previous scalefactor, so each one
+encodes all of its frames independently. All frames but the last one are
+full, so a channel can write its lms state and slices straight to their final
+offsets.
+
+Splitting a channel into segments breaks the dependency on the lms state of
+the previous frame. Each segment but the first one primes its lms state by
+encoding the last QOA_WARMUP_LEN samples before it and throwing them away, so
+the output differs slightly from a serial encode. */
+
+#define QOA_WARMUP_LEN (QOA_SLICE_LEN * 64)
+
+static QoaSlice qoa_encode_slice(const QoaEncode * job, int c, unsigned int sample_index, int slice_len, bool exhaustive, qoa_lms_t * lms, QoaSlice * prev) {
+    const short * slice_samples = job->samples + sample_index * job->qoa->channels + c;
+    QoaSlice best = {};
+    if (exhaustive || prev->scalefactor < 0) {
+        qoa_search(slice_samples, job->qoa->channels, slice_len, lms, prev->scalefactor > 0 ? prev->scalefactor : 0, &best);
+    } else {
+        qoa_search_window(slice_samples, job->qoa->channels, slice_len, lms, prev, job->effort, &best);
+    }
+    *prev = best;
+    *lms = best.lms;
+    return best;
+}
+
+static void qoa_encode_segment_job(void * arg, int index) {
+    QoaEncode * job = (QoaEncode *)arg;
+    const qoa_desc * qoa = job->qoa;
+    unsigned int channels = qoa->channels;
+    int c = index % channels;
+    int effort = job->effort;
+
+    qoa_lms_t lms = {};
+    lms.weights[2] = -(1 << 13);
+    lms.weights[3] = (1 << 14);
+
+    /* The exhaustive search restarts from zero on every frame like qoa.h does,
+    the windowed search keeps following the previous slice across frames and
+    only searches exhaustively for the very first slice. */
+    bool exhaustive = effort >= 16;
+    QoaSlice prev = {};
+    prev.scalefactor = -1;
+    qoa_uint64_t error = 0;
+
+    unsigned int frame_index = index / channels * job->segment_frames;
+    unsigned int segment_start = frame_index * QOA_FRAME_LEN;
+    unsigned int segment_end = qoa_clamp(segment_start + job->segment_frames * QOA_FRAME_LEN, 0, qoa->samples);
+
+    for (unsigned int sample_index = segment_start >= QOA_WARMUP_LEN ? segment_start - QOA_WARMUP_LEN : segment_start; sample_index < segment_start; sample_index += QOA_SLICE_LEN) {
+        qoa_encode_slice(job, c, sample_index, QOA_SLICE_LEN, exhaustive, &lms, &prev);
+    }
+
+    for (unsigned int frame_start = segment_start; frame_start < segment_end; frame_start += QOA_FRAME_LEN) {
+        unsigned int frame_len = qoa_clamp(QOA_FRAME_LEN, 0, qoa->samples - frame_start);
+        unsigned char * frame = job->bytes + 8 + frame_index++ * QOA_FRAME_SIZE(channels, QOA_SLICES_PER_FRAME);
+
+        qoa_uint64_t weights = 0;
+        qoa_uint64_t history = 0;
+        for (int i = 0; i < QOA_LMS_LEN; i++) {
+            history = (history << 16) | (lms.history[i] & 0xffff);
+            weights = (weights << 16) | (lms.weights[i] & 0xffff);
+        }
+        unsigned int p = 8 + 16 * c;
+        qoa_write_u64(history, frame, &p);
+        qoa_write_u64(weights, frame, &p);
+
+        if (exhaustive) {
+            prev.scalefactor = 0;
+        }
+
+        for (unsigned int sample_index = 0; sample_index < frame_len; sample_index += QOA_SLICE_LEN) {
+            int slice_len = qoa_clamp(QOA_SLICE_LEN, 0, frame_len - sample_index);
+            QoaSlice best = qoa_encode_slice(job, c, frame_start + sample_index, slice_len, exhaustive, &lms, &prev);
+            error += best.error;
+
+            best.slice <<= (QOA_SLICE_LEN - slice_len) * 3;
+            p = 8 + 16 * channels + 8 * (sample_index / QOA_SLICE_LEN * channels + c);
+            qoa_write_u64(best.slice, frame, &p);
+        }
+    }
+
+    job->error[index] = error;
+}
+
+static void * qoa_encode_fast(const short * sample_data, qoa_desc * qoa, int effort, int segments, int threads, unsigned int * out_len) {
+    if (
+        qoa->samples == 0 ||
+        qoa->samplerate == 0 || qoa->samplerate > 0xffffff ||
+        qoa->channels == 0 || qoa->channels > QOA_MAX_CHANNELS
+    ) {
+        return NULL;
+    }
+
+    unsigned int num_frames = (qoa->samples + QOA_FRAME_LEN - 1) / QOA_FRAME_LEN;
+    unsigned int num_slices = (qoa->samples + QOA_SLICE_LEN - 1) / QOA_SLICE_LEN;
+    unsigned int encoded_size = 8 + num_frames * 8 + num_frames * QOA_LMS_LEN * 4 * qoa->channels + num_slices * 8 * qoa->channels;
+
+    unsigned char * bytes = (unsigned char *)QOA_MALLOC(encoded_size);
+
+    unsigned int p = qoa_encode_header(qoa, bytes);
+    for (unsigned int sample_index = 0; sample_index < qoa->samples; sample_index += QOA_FRAME_LEN) {
+        unsigned int frame_len = qoa_clamp(QOA_FRAME_LEN, 0, qoa->samples - sample_index);
+        unsigned int slices = (frame_len + QOA_SLICE_LEN - 1) / QOA_SLICE_LEN;
+        unsigned int frame_size = QOA_FRAME_SIZE(qoa->channels, slices);
+        unsigned int q = p;
+        qoa_write_u64((
+            (qoa_uint64_t)qoa->channels   << 56 |
+            (qoa_uint64_t)qoa->samplerate << 32 |
+            (qoa_uint64_t)frame_len       << 16 |
+            (qoa_uint64_t)frame_size
+        ), bytes, &q);
+        p += frame_size;
+    }
+
+    unsigned int segment_frames = (num_frames + segments - 1) / segments;
+    int jobs = qoa->channels * ((num_frames + segment_frames - 1) / segment_frames);
+    QoaEncode job = {sample_data, qoa, effort, segment_frames, bytes, NULL};
+    job.error = (qoa_uint64_t *)calloc(jobs, sizeof(qoa_uint64_t));
+    parallel_for(jobs, threads, qoa_encode_segment_job, &job);
+
+    qoa->error = 0;
+    for (int i = 0; i < jobs; i++) {
+        qoa->error += job.error[i];
+    }
+    free(job.error);
+
+    *out_len = p;
+    return bytes;
+}
+
+/* Decoders write into a writable out buffer when one is given and return the
+number of bytes written, otherwise they decode straight into a new bytes
+object. */
+
+static bool get_output(PyObject * out, Py_buffer * view, Py_ssize_t size, PyObject ** res) {
+    *res = NULL;
+    if (out == Py_None) {
+        *res = PyBytes_FromStringAndSize(NULL, size);
+        view->buf = *res ? PyBytes_AS_STRING(*res) : NULL;
+        return *res != NULL;
+    }
+    if (PyObject_GetBuffer(out, view, PyBUF_WRITABLE) < 0) {
+        return false;
+    }
+    if (view->len < size) {
+        PyErr_Format(PyExc_ValueError, "out must be at least %zd bytes", size);
+        PyBuffer_Release(view);
+        return false;
+    }
+    return true;
+}
+
+static PyObject * decode_result(PyObject * res, Py_buffer * view, Py_ssize_t written, int samplerate, int channels) {
+    PyObject * is_stereo = channels == 2 ? Py_True : Py_False;
+    if (!res) {
+        PyBuffer_Release(view);
+        return Py_BuildValue("(niO)", written, samplerate, is_stereo);
+    }
+    if (written != PyBytes_GET_SIZE(res) && _PyBytes_Resize(&res, written) < 0) {
+        return NULL;
+    }
+    return Py_BuildValue("(NiO)", res, samplerate, is_stereo);
+}
+
 static PyObject * meth_qoa_decode(PyObject * self, PyObject * args, PyObject * kwargs) {
-    static char * keywords[] = {"data", NULL};
+    static char * keywords[] = {"data", "threads", "out", NULL};
     PyObject * qoa_data;
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O", keywords, &qoa_data)) {
+    int threads = 1;
+    PyObject * out = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|iO", keywords, &qoa_data, &threads, &out)) {
         return NULL;
     }
-    if (!PyBytes_Check(qoa_data)) {
-        PyErr_SetString(PyExc_TypeError, "data must be bytes");
+    Py_buffer view;
+    if (PyObject_GetBuffer(qoa_data, &view, PyBUF_SIMPLE) < 0) {
         return NULL;
     }
-    Py_ssize_t size = PyBytes_Size(qoa_data);
-    const char * buffer = PyBytes_AsString(qoa_data);
     qoa_desc qoa = {};
-    short * ptr = qoa_decode((unsigned char *)buffer, (int)size, &qoa);
-    PyObject * data = PyBytes_FromStringAndSize((char *)ptr, qoa.samples * sizeof(short));
-    free(ptr);
-    PyObject * is_stereo = qoa.channels == 2 ? Py_True : Py_False;
-    return Py_BuildValue("(NiO)", data, qoa.samplerate, is_stereo);
+    unsigned int p = qoa_decode_header((unsigned char *)view.buf, (int)view.len, &qoa);
+    if (!p || qoa.channels > QOA_MAX_CHANNELS) {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_RuntimeError, "failed to decode qoa data");
+        return NULL;
+    }
+    Py_buffer output;
+    PyObject * res;
+    if (!get_output(out, &output, (Py_ssize_t)qoa.samples * qoa.channels * sizeof(short), &res)) {
+        PyBuffer_Release(&view);
+        return NULL;
+    }
+    int samples = 0;
+    Py_BEGIN_ALLOW_THREADS
+    samples = qoa_decode_parallel((unsigned char *)view.buf, (int)view.len, p, &qoa, (short *)output.buf, threads);
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&view);
+    if (samples < 0) {
+        if (!res) {
+            PyBuffer_Release(&output);
+        }
+        Py_XDECREF(res);
+        PyErr_SetString(PyExc_RuntimeError, "failed to decode qoa data");
+        return NULL;
+    }
+    return decode_result(res, &output, (Py_ssize_t)samples * qoa.channels * sizeof(short), qoa.samplerate, qoa.channels);
 }
 
 static PyObject * meth_qoa_encode(PyObject * self, PyObject * args, PyObject * kwargs) {
-    static char * keywords[] = {"data", "samplerate", "stereo", NULL};
+    static char * keywords[] = {"data", "samplerate", "stereo", "effort", "report_error", "segments", "threads", NULL};
 
     PyObject * data;
     int samplerate = 44100;
     int stereo = false;
+    int effort = 16;
+    int report_error = false;
+    int segments = 1;
+    int threads = 1;
+
+    int args_ok = PyArg_ParseTupleAndKeywords(
+        args, kwargs, "O|ipipii", keywords, &data, &samplerate, &stereo, &effort, &report_error, &segments, &threads
+    );
+
+    if (!args_ok) {
+        return NULL;
+    }
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|ip", keywords, &data, &samplerate, &stereo)) {
+    if (effort < 0 || effort > 16) {
+        PyErr_SetString(PyExc_ValueError, "effort must be between 0 and 16");
         return NULL;
     }
 
-    if (!PyBytes_Check(data)) {
-        PyErr_SetString(PyExc_TypeError, "data must be bytes");
+    if (segments < 1) {
+        PyErr_SetString(PyExc_ValueError, "segments must be positive");
         return NULL;
     }
 
-    const char * buffer = PyBytes_AsString(data);
-    Py_ssize_t samples = PyBytes_Size(data) / sizeof(short);
-    qoa_desc qoa = {(unsigned)(stereo ? 2 : 1), (unsigned)samplerate, (unsigned)samples};
+    Py_buffer view;
+    if (PyObject_GetBuffer(data, &view, PyBUF_SIMPLE) < 0) {
+        return NULL;
+    }
+
+    int channels = stereo ? 2 : 1;
+    Py_ssize_t samples = view.len / sizeof(short) / channels;
+    qoa_desc qoa = {(unsigned)channels, (unsigned)samplerate, (unsigned)samples};
     unsigned int size = 0;
-    void * ptr = qoa_encode((short *)buffer, &qoa, &size);
+    void * ptr = NULL;
+    Py_BEGIN_ALLOW_THREADS
+    ptr = qoa_encode_fast((short *)view.buf, &qoa, effort, segments, threads, &size);
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&view);
+    if (!ptr) {
+        PyErr_SetString(PyExc_RuntimeError, "failed to encode qoa data");
+        return NULL;
+    }
     PyObject * res = PyBytes_FromStringAndSize((char *)ptr, size);
     free(ptr);
+    if (report_error) {
+        return Py_BuildValue("(Nd)", res, qoa.error);
+    }
     return res;
 }
 
-static PyObject * meth_ogg_decode(PyObject * self, PyObject * args, PyObject * kwargs) {
-    static char * keywords[] = {"data", NULL};
-
-    PyObject * ogg_data;
+/* Incremental decoding for streams. QOA frames are decoded one at a time into
+a frame sized buffer, Ogg Vorbis decodes straight into the output. */
+
+static bool decoder_open(Decoder * decoder, const unsigned char * data, unsigned int size) {
+    memset(decoder, 0, sizeof(Decoder));
+    decoder->data = data;
+    decoder->size = size;
+    if (size >= 4 && !memcmp(data, "qoaf", 4)) {
+        unsigned int p = qoa_decode_header(data, size, &decoder->qoa);
+        if (!p || decoder->qoa.channels < 1 || decoder->qoa.channels > 2) {
+            return false;
+        }
+        unsigned int max_frames = (decoder->qoa.samples + QOA_FRAME_LEN - 1) / QOA_FRAME_LEN;
+        decoder->frames = (unsigned int *)malloc((max_frames ? max_frames : 1) * sizeof(unsigned int));
+        decoder->frame = (short *)malloc(QOA_FRAME_LEN * decoder->qoa.channels * sizeof(short));
+        int num_frames = decoder->frames && decoder->frame ? qoa_index_frames(data, size, p, decoder->qoa.channels, decoder->qoa.samples, decoder->frames, max_frames) : -1;
+        if (num_frames < 0) {
+            free(decoder->frames);
+            free(decoder->frame);
+            decoder->frames = NULL;
+            decoder->frame = NULL;
+            return false;
+        }
+        decoder->num_frames = num_frames;
+        decoder->next_frame = 0;
+        decoder->samplerate = decoder->qoa.samplerate;
+        decoder->channels = decoder->qoa.channels;
+        decoder->samples = decoder->qoa.samples;
+        return true;
+    }
+    if (size >= 4 && !memcmp(data, "OggS", 4)) {
+        decoder->vorbis = stb_vorbis_open_memory(data, size, NULL, NULL);
+        if (!decoder->vorbis) {
+            return false;
+        }
+        stb_vorbis_info info = stb_vorbis_get_info(decoder->vorbis);
+        decoder->samplerate = info.sample_rate;
+        decoder->channels = info.channels;
+        decoder->samples = stb_vorbis_stream_length_in_samples(decoder->vorbis);
+        return decoder->channels >= 1 && decoder->channels <= 2;
+    }
+    return false;
+}
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O", keywords, &ogg_data)) {
-        return NULL;
+static bool decoder_next_frame(Decoder * decoder) {
+    decoder->frame_pos = 0;
+    decoder->frame_len = 0;
+    if (decoder->next_frame >= decoder->num_frames) {
+        return false;
+    }
+    unsigned int index = decoder->next_frame++;
+    unsigned int offset = decoder->frames[index];
+    const unsigned char * bytes = decoder->data + offset;
+    if (!qoa_frame_valid(bytes, decoder->size - offset, decoder->channels, decoder->samples - index * QOA_FRAME_LEN)) {
+        return false;
     }
+    qoa_decode_frame(bytes, decoder->size - offset, &decoder->qoa, decoder->frame, &decoder->frame_len);
+    return decoder->frame_len != 0;
+}
 
-    if (!PyBytes_Check(ogg_data)) {
-        PyErr_SetString(PyExc_TypeError, "data must be bytes");
-        return NULL;
+static int decoder_read(Decoder * decoder, short * output, int samples) {
+    if (decoder->vorbis) {
+        int done = stb_vorbis_get_samples_short_interleaved(decoder->vorbis, decoder->channels, output, samples * decoder->channels);
+        decoder->position += done;
+        return done;
     }
+    int channels = decoder->channels;
+    int done = 0;
+    while (done < samples) {
+        if (decoder->frame_pos == decoder->frame_len && !decoder_next_frame(decoder)) {
+            break;
+        }
+        int count = qoa_clamp(decoder->frame_len - decoder->frame_pos, 0, samples - done);
+        memcpy(output + done * channels, decoder->frame + decoder->frame_pos * channels, count * channels * sizeof(short));
+        decoder->frame_pos += count;
+        done += count;
+    }
+    decoder->position += done;
+    return done;
+}
 
-    Py_ssize_t buffer_size = PyBytes_Size(ogg_data);
-    const char * buffer = PyBytes_AsString(ogg_data);
-    int samplerate = 0;
-    int channels = 0;
-    short * output = NULL;
+/* QOA frames are indexed on open, seeking decodes only the target frame. */
 
-    int size = stb_vorbis_decode_memory((unsigned char *)buffer, (int)buffer_size, &channels, &samplerate, &output);
-    if (size <= 0) {
-        PyErr_SetString(PyExc_RuntimeError, "failed to decode ogg data");
-        return NULL;
+static bool decoder_seek(Decoder * decoder, unsigned int sample) {
+    if (sample > decoder->samples) {
+        return false;
+    }
+    if (decoder->vorbis) {
+        if (!stb_vorbis_seek(decoder->vorbis, sample)) {
+            return false;
+        }
+        decoder->position = sample;
+        return true;
+    }
+    if (sample / QOA_FRAME_LEN > decoder->num_frames) {
+        return false;
     }
+    decoder->next_frame = sample / QOA_FRAME_LEN;
+    decoder->frame_len = 0;
+    decoder->frame_pos = 0;
+    if (sample % QOA_FRAME_LEN) {
+        if (!decoder_next_frame(decoder) || decoder->frame_len < sample % QOA_FRAME_LEN) {
+            return false;
+        }
+        decoder->frame_pos = sample % QOA_FRAME_LEN;
+    }
+    decoder->position = sample;
+    return true;
+}
 
-    PyObject * data = PyBytes_FromStringAndSize((char *)output, size * sizeof(short));
-    free(output);
-    PyObject * is_stereo = channels == 2 ? Py_True : Py_False;
-    return Py_BuildValue("(NiO)", data, samplerate, is_stereo);
+static void decoder_rewind(Decoder * decoder) {
+    decoder->position = 0;
+    if (decoder->vorbis) {
+        stb_vorbis_seek_start(decoder->vorbis);
+        return;
+    }
+    decoder->next_frame = 0;
+    decoder->frame_len = 0;
+    decoder->frame_pos = 0;
 }
 
-static PyObject * meth_init(PyObject * self, PyObject * args, PyObject * kwargs) {
-    const char * keywords[] = {NULL};
+static void decoder_close(Decoder * decoder) {
+    if (decoder->vorbis) {
+        stb_vorbis_close(decoder->vorbis);
+    }
+    free(decoder->frames);
+    free(decoder->frame);
+    memset(decoder, 0, sizeof(Decoder));
+}
+
+static PyObject * meth_ogg_decode(PyObject * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"data", "out", NULL};
+
+    PyObject * ogg_data;
+    PyObject * out = Py_None;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "", (char **)keywords)) {
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O", keywords, &ogg_data, &out)) {
+        return NULL;
+    }
+
+    Py_buffer view;
+    if (PyObject_GetBuffer(ogg_data, &view, PyBUF_SIMPLE) < 0) {
+        return NULL;
+    }
+
+    Decoder decoder = {};
+    const unsigned char * ptr = (const unsigned char *)view.buf;
+    bool ok = view.len >= 4 && !memcmp(ptr, "OggS", 4) && decoder_open(&decoder, ptr, (unsigned int)view.len) && decoder.samples;
+    if (!ok) {
+        decoder_close(&decoder);
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_RuntimeError, "failed to decode ogg data");
+        return NULL;
+    }
+
+    Py_buffer output;
+    PyObject * res;
+    if (!get_output(out, &output, (Py_ssize_t)decoder.samples * decoder.channels * sizeof(short), &res)) {
+        decoder_close(&decoder);
+        PyBuffer_Release(&view);
+        return NULL;
+    }
+
+    int samples = 0;
+    Py_BEGIN_ALLOW_THREADS
+    samples = decoder_read(&decoder, (short *)output.buf, decoder.samples);
+    Py_END_ALLOW_THREADS
+    int samplerate = decoder.samplerate;
+    int channels = decoder.channels;
+    decoder_close(&decoder);
+    PyBuffer_Release(&view);
+    return decode_result(res, &output, (Py_ssize_t)samples * channels * sizeof(short), samplerate, channels);
+}
+
+static bool decode_audio(const unsigned char * data, int size, Pcm * pcm) {
+    if (size >= 4 && !memcmp(data, "qoaf", 4)) {
+        qoa_desc qoa = {};
+        unsigned int p = qoa_decode_header(data, size, &qoa);
+        bool header_ok = p && qoa.channels >= 1 && qoa.channels <= 2;
+        pcm->samples = header_ok ? (short *)malloc((size_t)qoa.samples * qoa.channels * sizeof(short) + 1) : NULL;
+        int samples = pcm->samples ? qoa_decode_parallel(data, size, p, &qoa, pcm->samples, 1) : -1;
+        if (samples < 0) {
+            free(pcm->samples);
+            pcm->samples = NULL;
+        }
+        pcm->size = samples * qoa.channels * sizeof(short);
+        pcm->samplerate = qoa.samplerate;
+        pcm->channels = qoa.channels;
+    } else if (size >= 4 && !memcmp(data, "OggS", 4)) {
+        int samples = stb_vorbis_decode_memory(data, size, &pcm->channels, &pcm->samplerate, &pcm->samples);
+        pcm->size = samples > 0 ? samples * pcm->channels * sizeof(short) : 0;
+    } else {
+        return false;
+    }
+    if (pcm->samples && (pcm->channels < 1 || pcm->channels > 2)) {
+        free(pcm->samples);
+        pcm->samples = NULL;
+    }
+    return pcm->samples != NULL;
+}
+
+static void unmap_file(FileMap * map) {
+    if (map->data) {
+        UnmapViewOfFile(map->data);
+    }
+    if (map->mapping) {
+        CloseHandle(map->mapping);
+    }
+    if (map->file) {
+        CloseHandle(map->file);
+    }
+    memset(map, 0, sizeof(FileMap));
+}
+
+static bool map_file(const wchar_t * path, FileMap * map) {
+    memset(map, 0, sizeof(FileMap));
+    map->file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (map->file == INVALID_HANDLE_VALUE) {
+        map->file = NULL;
+        return false;
+    }
+    LARGE_INTEGER file_size = {};
+    bool ok = GetFileSizeEx(map->file, &file_size) && file_size.QuadPart > 0 && file_size.QuadPart < 0x7fffffff;
+    map->mapping = ok ? CreateFileMappingW(map->file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+    map->data = map->mapping ? (const unsigned char *)MapViewOfFile(map->mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!map->data) {
+        unmap_file(map);
+        return false;
+    }
+    map->size = (int)file_size.QuadPart;
+    return true;
+}
+
+/* Returns a 64-bit hash, a second independent 64-bit lane goes to check when
+given. Shared buffers are keyed on both lanes and the size. */
+
+static unsigned long long hash_bytes(const void * data, size_t size, unsigned long long * check) {
+    const unsigned long long k = 0x9e3779b97f4a7c15ull;
+    const unsigned long long k2 = 0xc2b2ae3d27d4eb4full;
+    const unsigned char * ptr = (const unsigned char *)data;
+    unsigned long long h = size * k;
+    unsigned long long h2 = ~(size * k2);
+    while (size >= 8) {
+        unsigned long long word;
+        memcpy(&word, ptr, 8);
+        h = (h ^ word) * k;
+        h ^= h >> 29;
+        h2 = (h2 ^ (word >> 32 | word << 32)) * k2;
+        h2 ^= h2 >> 31;
+        ptr += 8;
+        size -= 8;
+    }
+    unsigned long long tail = 0;
+    memcpy(&tail, ptr, size);
+    h = (h ^ tail) * k;
+    if (check) {
+        h2 = (h2 ^ tail) * k2;
+        h2 ^= h2 >> 33;
+        h2 *= k;
+        *check = h2 ^ (h2 >> 29);
+    }
+    return h ^ (h >> 32);
+}
+
+/* With a cache directory set, decoded pcm is stored as <hash>.pcm with a page
+sized header, so later loads map the file and upload it without decoding.
+PCM_CACHE_VERSION must change whenever a decoder changes its output. */
+
+static void pcm_cache_path(wchar_t * path, int length, const wchar_t * suffix, unsigned long long hash) {
+    swprintf(path, length, L"%ls\\%016llx%ls", pcm_cache_dir, hash, suffix);
+}
+
+static bool read_pcm_cache(unsigned long long hash, int input_size, Pcm * pcm) {
+    wchar_t path[1024];
+    pcm_cache_path(path, 1024, L".pcm", hash);
+    if (!map_file(path, &pcm->file)) {
+        return false;
+    }
+    const PcmCacheHeader * header = (const PcmCacheHeader *)pcm->file.data;
+    bool valid = (
+        pcm->file.size >= PCM_CACHE_HEADER && !memcmp(header->magic, "SPCM", 4) &&
+        header->version == PCM_CACHE_VERSION && header->input_size == (unsigned int)input_size &&
+        header->size <= (unsigned int)(pcm->file.size - PCM_CACHE_HEADER) &&
+        header->channels >= 1 && header->channels <= 2
+    );
+    if (!valid) {
+        unmap_file(&pcm->file);
+        return false;
+    }
+    pcm->samples = (short *)(pcm->file.data + PCM_CACHE_HEADER);
+    pcm->size = header->size;
+    pcm->samplerate = header->samplerate;
+    pcm->channels = header->channels;
+    return true;
+}
+
+static void write_pcm_cache(unsigned long long hash, int input_size, const Pcm * pcm) {
+    wchar_t temp[1024];
+    wchar_t path[1024];
+    wchar_t suffix[32];
+    swprintf(suffix, 32, L".%lu.tmp", GetCurrentThreadId());
+    pcm_cache_path(temp, 1024, suffix, hash);
+    pcm_cache_path(path, 1024, L".pcm", hash);
+
+    HANDLE file = CreateFileW(temp, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return;
+    }
+
+    char header[PCM_CACHE_HEADER] = {};
+    PcmCacheHeader info = {{'S', 'P', 'C', 'M'}, PCM_CACHE_VERSION, (unsigned int)input_size, (unsigned int)pcm->size, (unsigned int)pcm->samplerate, (unsigned int)pcm->channels};
+    memcpy(header, &info, sizeof(info));
+
+    DWORD written = 0;
+    bool ok = WriteFile(file, header, PCM_CACHE_HEADER, &written, NULL) && written == PCM_CACHE_HEADER;
+    ok = ok && WriteFile(file, pcm->samples, pcm->size, &written, NULL) && written == (DWORD)pcm->size;
+    CloseHandle(file);
+
+    if (!ok || !MoveFileExW(temp, path, MOVEFILE_REPLACE_EXISTING)) {
+        DeleteFileW(temp);
+    }
+}
+
+/* The hash is of the input with seed zero, callers usually have it already
+and it is only used with a cache directory. */
+
+static bool load_pcm(const unsigned char * data, int size, unsigned long long hash, Pcm * pcm) {
+    if (!pcm_cache_dir) {
+        return decode_audio(data, size, pcm);
+    }
+    if (read_pcm_cache(hash, size, pcm)) {
+        return true;
+    }
+    if (!decode_audio(data, size, pcm)) {
+        return false;
+    }
+    write_pcm_cache(hash, size, pcm);
+    return true;
+}
+
+static void free_pcm(Pcm * pcm) {
+    if (pcm->file.data) {
+        unmap_file(&pcm->file);
+    } else {
+        free(pcm->samples);
+    }
+    pcm->samples = NULL;
+}
+
+static int upload_pcm(const void * samples, int size, int samplerate, int stereo) {
+    int buffer = 0;
+    alGenBuffers(1, &buffer);
+    int format = stereo ? AL_FORMAT_STEREO16 : AL_FORMAT_MONO16;
+    alBufferData(buffer, format, samples, size, samplerate);
+    return buffer;
+}
+
+static void CALLBACK task_worker(PTP_CALLBACK_INSTANCE instance, void * arg) {
+    Task * task = (Task *)arg;
+    FileMap file = {};
+
+    if (task->path && !map_file(task->path, &file)) {
+        task->error = "failed to read file";
+    }
+
+    Pcm pcm = {};
+    const unsigned char * data = task->path ? file.data : (const unsigned char *)task->view.buf;
+    int size = task->path ? file.size : (int)task->view.len;
+    if (!task->error) {
+        unsigned long long hash = pcm_cache_dir ? hash_bytes(data, size, NULL) : 0;
+        if (!load_pcm(data, size, hash, &pcm)) {
+            task->error = "failed to decode audio data";
+        }
+    }
+    unmap_file(&file);
+
+    if (!task->error) {
+        task->buffer = upload_pcm(pcm.samples, pcm.size, pcm.samplerate, pcm.channels == 2);
+        task->size = pcm.size;
+        task->samplerate = pcm.samplerate;
+        task->stereo = pcm.channels == 2;
+        free_pcm(&pcm);
+    }
+
+    AcquireSRWLockExclusive(&completed_lock);
+    task->next = completed;
+    completed = task;
+    ReleaseSRWLockExclusive(&completed_lock);
+
+    InterlockedExchange(&task->done, 1);
+    SetEvent(task->event);
+}
+
+/* Buffers loaded from identical input are shared across names. The key is a
+128-bit hash of the input and its size, nothing is kept around to compare. */
+
+static Buffer * find_shared(unsigned long long hash, unsigned long long check, int size) {
+    if (!buffer_table) {
+        return NULL;
+    }
+    Buffer * buffer = buffer_table[hash & buffer_table_mask];
+    while (buffer && (buffer->hash != hash || buffer->check != check || buffer->hash_size != size)) {
+        buffer = buffer->hash_next;
+    }
+    return buffer;
+}
+
+static void share_buffer(Buffer * buffer, unsigned long long hash, unsigned long long check, int size) {
+    if (buffer_table_count >= buffer_table_mask) {
+        int mask = buffer_table_mask ? buffer_table_mask * 2 + 1 : 255;
+        Buffer ** table = (Buffer **)PyMem_Calloc(mask + 1, sizeof(Buffer *));
+        for (int i = 0; buffer_table && i <= buffer_table_mask; ++i) {
+            while (Buffer * item = buffer_table[i]) {
+                buffer_table[i] = item->hash_next;
+                item->hash_next = table[item->hash & mask];
+                table[item->hash & mask] = item;
+            }
+        }
+        PyMem_Free(buffer_table);
+        buffer_table = table;
+        buffer_table_mask = mask;
+    }
+    buffer->hash = hash;
+    buffer->check = check;
+    buffer->hash_size = size;
+    buffer->hashed = true;
+    buffer->hash_next = buffer_table[hash & buffer_table_mask];
+    buffer_table[hash & buffer_table_mask] = buffer;
+    buffer_table_count += 1;
+}
+
+static void unshare_buffer(Buffer * buffer) {
+    if (!buffer->hashed) {
+        return;
+    }
+    Buffer ** link = &buffer_table[buffer->hash & buffer_table_mask];
+    while (*link != buffer) {
+        link = &(*link)->hash_next;
+    }
+    *link = buffer->hash_next;
+    buffer->hashed = false;
+    buffer_table_count -= 1;
+}
+
+static Buffer * new_buffer(int buffer, int size, int samplerate, int stereo) {
+    Buffer * res = PyObject_New(Buffer, Buffer_type);
+    res->next = NULL;
+    res->lru_prev = NULL;
+    res->lru_next = NULL;
+    res->cached = false;
+    res->voices = 0;
+    res->hash_next = NULL;
+    res->hash = 0;
+    res->check = 0;
+    res->hash_size = 0;
+    res->hashed = false;
+    InitializeSRWLock(&res->lock);
+    res->state = buffer ? BUFFER_READY : BUFFER_COLD;
+    res->buffer = buffer;
+    res->size = size;
+    res->samplerate = samplerate;
+    res->stereo = stereo;
+    res->data = NULL;
+    res->data_size = 0;
+    res->owner = NULL;
+    res->path = NULL;
+    return res;
+}
+
+static Buffer * add_buffer(PyObject * name, int buffer, int size, int samplerate, int stereo) {
+    Buffer * res = new_buffer(buffer, size, samplerate, stereo);
+    PyDict_SetItem(buffers, name, (PyObject *)res);
+    Py_DECREF(res);
+    return res;
+}
+
+/* Buffers that can be decoded again from their compressed data are kept in
+an LRU list and count against the cache budget. The least recently played
+ones without a live voice are evicted back to cold on update. */
+
+static void cache_unlink(Buffer * buffer) {
+    if (!buffer->cached) {
+        return;
+    }
+    *(buffer->lru_prev ? &buffer->lru_prev->lru_next : &cache.head) = buffer->lru_next;
+    *(buffer->lru_next ? &buffer->lru_next->lru_prev : &cache.tail) = buffer->lru_prev;
+    buffer->lru_prev = NULL;
+    buffer->lru_next = NULL;
+    buffer->cached = false;
+    cache.bytes -= buffer->size;
+}
+
+static void cache_touch(Buffer * buffer) {
+    if (buffer->state != BUFFER_READY || (!buffer->data && !buffer->path)) {
+        return;
+    }
+    cache_unlink(buffer);
+    buffer->lru_next = cache.head;
+    *(cache.head ? &cache.head->lru_prev : &cache.tail) = buffer;
+    cache.head = buffer;
+    buffer->cached = true;
+    cache.bytes += buffer->size;
+}
+
+/* Eager buffers decoded from bytes or a file keep them like lazy ones, so
+they count against the cache budget and can be evicted and decoded again.
+Takes ownership of the path. Other inputs may change and stay pinned. */
+
+static void keep_input(Buffer * buffer, PyObject * data, wchar_t * path) {
+    if (path) {
+        buffer->path = path;
+    } else if (data && PyBytes_CheckExact(data)) {
+        Py_INCREF(data);
+        buffer->owner = data;
+        buffer->data = (const unsigned char *)PyBytes_AS_STRING(data);
+        buffer->data_size = (int)PyBytes_GET_SIZE(data);
+    }
+    cache_touch(buffer);
+}
+
+static void finish_task(Task * task) {
+    if (task->finished) {
+        return;
+    }
+    task->finished = true;
+
+    if (task->view.buf) {
+        PyBuffer_Release(&task->view);
+        task->view.buf = NULL;
+    }
+
+    if (!task->error) {
+        Buffer * buffer = add_buffer(task->name, task->buffer, task->size, task->samplerate, task->stereo);
+        keep_input(buffer, task->data, task->path);
+        task->path = NULL;
+    }
+
+    if (task->callback != Py_None) {
+        PyObject * res = PyObject_CallFunctionObjArgs(task->callback, (PyObject *)task, NULL);
+        if (!res) {
+            PyErr_WriteUnraisable(task->callback);
+        }
+        Py_XDECREF(res);
+    }
+}
+
+static void trim_cache() {
+    Buffer * buffer = cache.tail;
+    while (cache.budget && cache.bytes > cache.budget && buffer) {
+        Buffer * prev = buffer->lru_prev;
+        if (!buffer->voices) {
+            AcquireSRWLockExclusive(&buffer->lock);
+            cache_unlink(buffer);
+            alDeleteBuffers(1, &buffer->buffer);
+            buffer->buffer = 0;
+            buffer->size = 0;
+            InterlockedExchange(&buffer->state, BUFFER_COLD);
+            ReleaseSRWLockExclusive(&buffer->lock);
+            cache.evictions += 1;
+        }
+        buffer = prev;
+    }
+}
+
+static void drain_tasks() {
+    if (!completed && !prefetched) {
+        return;
+    }
+
+    AcquireSRWLockExclusive(&completed_lock);
+    Task * task = completed;
+    Buffer * buffer = prefetched;
+    completed = NULL;
+    prefetched = NULL;
+    ReleaseSRWLockExclusive(&completed_lock);
+
+    while (task) {
+        Task * next = task->next;
+        finish_task(task);
+        Py_DECREF(task);
+        task = next;
+    }
+
+    while (buffer) {
+        Buffer * next = buffer->next;
+        if (!buffer->cached) {
+            cache_touch(buffer);
+        }
+        Py_DECREF(buffer);
+        buffer = next;
+    }
+}
+
+static void begin_batch() {
+    if (batch_depth++) {
+        return;
+    }
+    if (alDeferUpdatesSOFT) {
+        alDeferUpdatesSOFT();
+    } else {
+        alcSuspendContext(context);
+    }
+}
+
+static void end_batch() {
+    if (--batch_depth) {
+        return;
+    }
+    if (alProcessUpdatesSOFT) {
+        alProcessUpdatesSOFT();
+    } else {
+        alcProcessContext(context);
+    }
+}
+
+static int alloc_source() {
+    if (!source_pool_free) {
+        return 0;
+    }
+    return source_pool[--source_pool_free];
+}
+
+static void free_source(int source) {
+    alSourcei(source, AL_BUFFER, 0);
+    source_pool[source_pool_free++] = source;
+}
+
+static int * source_voice(int source) {
+    int i = (int)((unsigned)source * 2654435761u) & source_mask;
+    while (source_keys[i] && source_keys[i] != source) {
+        i = (i + 1) & source_mask;
+    }
+    return source_keys[i] ? &source_voices[i] : NULL;
+}
+
+static void event_callback(int type, unsigned object, unsigned param, int length, const char * message, void * user) {
+    if (type != AL_EVENT_TYPE_SOURCE_STATE_CHANGED_SOFT || param != AL_STOPPED) {
+        return;
+    }
+    LONG tail = stopped.tail;
+    if (tail - stopped.head > stopped.mask) {
+        InterlockedExchange(&stopped.overflow, 1);
+        return;
+    }
+    stopped.items[tail & stopped.mask] = (int)object;
+    InterlockedExchange(&stopped.tail, tail + 1);
+}
+
+static void reap_voice(int index) {
+    Source * object = voices.object[index];
+    Buffer * buffer = voices.buffer[index];
+    free_source(voices.source[index]);
+    *source_voice(voices.source[index]) = -1;
+
+    int last = --voices.count;
+    if (index != last) {
+        voices.source[index] = voices.source[last];
+        voices.buffer[index] = voices.buffer[last];
+        voices.object[index] = voices.object[last];
+        voices.state[index] = voices.state[last];
+        voices.priority[index] = voices.priority[last];
+        voices.object[index]->voice = index;
+        *source_voice(voices.source[index]) = index;
+    }
+
+    object->voice = -1;
+    buffer->voices -= 1;
+    Py_DECREF(buffer);
+    Py_DECREF(object);
+}
+
+static int steal_source(int priority) {
+    int victim = -1;
+    for (int i = 0; i < voices.count; ++i) {
+        if (voices.priority[i] < priority && (victim < 0 || voices.priority[i] < voices.priority[victim])) {
+            victim = i;
+        }
+    }
+    if (victim < 0) {
+        return 0;
+    }
+    alSourceStop(voices.source[victim]);
+    reap_voice(victim);
+    return alloc_source();
+}
+
+/* Lazy buffers keep their compressed data or a path and are decoded the first
+time they are played or prefetched. The buffer lock is held while decoding,
+so a play waiting on a prefetch blocks until the upload is done. */
+
+static bool load_buffer(Buffer * buffer) {
+    AcquireSRWLockExclusive(&buffer->lock);
+    if (buffer->state == BUFFER_READY) {
+        ReleaseSRWLockExclusive(&buffer->lock);
+        return true;
+    }
+
+    InterlockedExchange(&buffer->state, BUFFER_LOADING);
+
+    FileMap file = {};
+    bool file_ok = !buffer->path || map_file(buffer->path, &file);
+    const unsigned char * data = buffer->path ? file.data : buffer->data;
+    int size = buffer->path ? file.size : buffer->data_size;
+
+    Pcm pcm = {};
+    unsigned long long hash = buffer->hashed || !file_ok || !pcm_cache_dir ? buffer->hash : hash_bytes(data, size, NULL);
+    bool decoded = file_ok && load_pcm(data, size, hash, &pcm);
+    unmap_file(&file);
+
+    if (decoded) {
+        buffer->buffer = upload_pcm(pcm.samples, pcm.size, pcm.samplerate, pcm.channels == 2);
+        buffer->size = pcm.size;
+        buffer->samplerate = pcm.samplerate;
+        buffer->stereo = pcm.channels == 2;
+        free_pcm(&pcm);
+    }
+
+    InterlockedExchange(&buffer->state, decoded ? BUFFER_READY : BUFFER_COLD);
+    ReleaseSRWLockExclusive(&buffer->lock);
+    return decoded;
+}
+
+static void CALLBACK prefetch_worker(PTP_CALLBACK_INSTANCE instance, void * arg) {
+    Buffer * buffer = (Buffer *)arg;
+    load_buffer(buffer);
+
+    AcquireSRWLockExclusive(&completed_lock);
+    buffer->next = prefetched;
+    prefetched = buffer;
+    ReleaseSRWLockExclusive(&completed_lock);
+}
+
+/* Returns a new reference, decoding drops the GIL and the buffer may get
+unloaded meanwhile. Only plays of cacheable buffers count as hits or misses. */
+
+static Buffer * find_buffer(PyObject * name, bool play) {
+    Buffer * buffer = Py_TYPE(name) == Buffer_type ? (Buffer *)name : (Buffer *)PyDict_GetItem(buffers, name);
+    if (!buffer) {
+        PyErr_SetString(PyExc_KeyError, "buffer not found");
+        return NULL;
+    }
+    Py_INCREF(buffer);
+    bool ready = buffer->state == BUFFER_READY;
+    if (play && (buffer->data || buffer->path)) {
+        *(ready ? &cache.hits : &cache.misses) += 1;
+    }
+    if (!ready) {
+        bool loaded = false;
+        Py_BEGIN_ALLOW_THREADS
+        loaded = load_buffer(buffer);
+        Py_END_ALLOW_THREADS
+        if (!loaded) {
+            Py_DECREF(buffer);
+            PyErr_SetString(PyExc_RuntimeError, "failed to decode audio data");
+            return NULL;
+        }
+    }
+    cache_touch(buffer);
+    return buffer;
+}
+
+static Source * start_voice(Buffer * buffer, int priority) {
+    int source = alloc_source();
+    if (!source) {
+        source = steal_source(priority);
+    }
+    if (!source) {
+        PyErr_SetString(PyExc_RuntimeError, "no free sources");
+        return NULL;
+    }
+
+    alSourcei(source, AL_BUFFER, buffer->buffer);
+
+    Source * res = PyObject_New(Source, Source_type);
+    res->voice = voices.count++;
+    voices.source[res->voice] = source;
+    voices.buffer[res->voice] = buffer;
+    voices.object[res->voice] = res;
+    voices.state[res->voice] = AL_PLAYING;
+    voices.priority[res->voice] = priority;
+    *source_voice(source) = res->voice;
+    buffer->voices += 1;
+    Py_INCREF(buffer);
+    Py_INCREF(res);
+    return res;
+}
+
+/* Unqueues the buffers OpenAL is done with and refills them. Called with
+stream_lock held, from the stream thread and when a stream starts. A source
+that ran dry is restarted, one that stopped at the end of the data ends the
+stream. */
+
+static void refill_stream(Stream * stream) {
+    if (stream->ended) {
+        return;
+    }
+
+    int processed = 0;
+    alGetSourcei(stream->source, AL_BUFFERS_PROCESSED, &processed);
+    if (processed > 0) {
+        alSourceUnqueueBuffers(stream->source, processed, stream->idle + stream->idle_count);
+        stream->idle_count += processed;
+    }
+
+    Decoder * decoder = &stream->decoder;
+    int format = decoder->channels == 2 ? AL_FORMAT_STEREO16 : AL_FORMAT_MONO16;
+    while (stream->idle_count && !stream->eof) {
+        int samples = decoder_read(decoder, stream->chunk, stream->chunk_samples);
+        if (!samples && stream->loop) {
+            decoder_rewind(decoder);
+            samples = decoder_read(decoder, stream->chunk, stream->chunk_samples);
+        }
+        if (!samples) {
+            stream->eof = true;
+            break;
+        }
+        int buffer = stream->idle[--stream->idle_count];
+        alBufferData(buffer, format, stream->chunk, samples * decoder->channels * sizeof(short), decoder->samplerate);
+        alSourceQueueBuffers(stream->source, 1, &buffer);
+    }
+
+    int state = 0;
+    alGetSourcei(stream->source, AL_SOURCE_STATE, &state);
+    if (state == AL_PLAYING || state == AL_PAUSED) {
+        return;
+    }
+    if (stream->idle_count == STREAM_BUFFERS) {
+        InterlockedExchange(&stream->ended, 1);
+    } else if (stream->state == AL_PLAYING) {
+        alSourcePlay(stream->source);
+    }
+}
+
+static DWORD WINAPI stream_worker(void * arg) {
+    while (!stream_quit) {
+        AcquireSRWLockExclusive(&stream_lock);
+        for (Stream * stream = streams; stream; stream = stream->next) {
+            refill_stream(stream);
+        }
+        ReleaseSRWLockExclusive(&stream_lock);
+        WaitForSingleObject(stream_wake, 20);
+    }
+    return 0;
+}
+
+static void reap_streams(bool all) {
+    AcquireSRWLockExclusive(&stream_lock);
+    Stream * ended = NULL;
+    Stream ** link = &streams;
+    while (Stream * stream = *link) {
+        if (stream->ended || all) {
+            *link = stream->next;
+            stream->next = ended;
+            ended = stream;
+        } else {
+            link = &stream->next;
+        }
+    }
+    ReleaseSRWLockExclusive(&stream_lock);
+
+    while (ended) {
+        Stream * next = ended->next;
+        alSourceStop(ended->source);
+        free_source(ended->source);
+        ended->source = 0;
+        ended->state = AL_STOPPED;
+        InterlockedExchange(&ended->ended, 1);
+        Py_DECREF(ended);
+        ended = next;
+    }
+}
+
+static bool get_floats(PyObject * obj, Py_buffer * view, int count, const char * name) {
+    if (obj == Py_None) {
+        return true;
+    }
+    if (PyObject_GetBuffer(obj, view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) < 0) {
+        return false;
+    }
+    bool is_float = view->itemsize == 4 && (!view->format || !strcmp(view->format, "f") || !strcmp(view->format, "<f"));
+    if (!is_float || view->len != count * (Py_ssize_t)sizeof(float)) {
+        PyErr_Format(PyExc_ValueError, "%s must contain %d float32 values", name, count);
+        PyBuffer_Release(view);
+        view->buf = NULL;
+        return false;
+    }
+    return true;
+}
+
+static void release_floats(Py_buffer * view) {
+    if (view->buf) {
+        PyBuffer_Release(view);
+    }
+}
+
+static void close_device() {
+    if (context) {
+        alcMakeContextCurrent(NULL);
+        alcDestroyContext(context);
+        context = NULL;
+    }
+    if (device) {
+        alcCloseDevice(device);
+        device = NULL;
+    }
+}
+
+/* Buffers and sources belong to the context, so the device is opened once. */
+
+static PyObject * meth_init(PyObject * self, PyObject * args, PyObject * kwargs) {
+    const char * keywords[] = {"sources", "cache_budget", "cache_dir", NULL};
+
+    int sources = 256;
+    long long cache_budget = 0;
+    PyObject * cache_dir = Py_None;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|iLO", (char **)keywords, &sources, &cache_budget, &cache_dir)) {
+        return NULL;
+    }
+
+    if (cache_dir != Py_None && !PyUnicode_Check(cache_dir)) {
+        PyErr_SetString(PyExc_TypeError, "cache_dir must be a str or None");
+        return NULL;
+    }
+
+    if (device) {
+        PyErr_SetString(PyExc_RuntimeError, "already initialized");
+        return NULL;
+    }
+
+    if (sources < 1) {
+        PyErr_SetString(PyExc_ValueError, "sources must be positive");
+        return NULL;
+    }
+
+    if (cache_budget < 0) {
+        PyErr_SetString(PyExc_ValueError, "cache_budget must not be negative");
+        return NULL;
+    }
+
+    wchar_t * cache_path = cache_dir != Py_None ? PyUnicode_AsWideCharString(cache_dir, NULL) : NULL;
+    if (cache_dir != Py_None && !cache_path) {
         return NULL;
     }
 
@@ -184,6 +2013,7 @@ static PyObject * meth_init(PyObject * self, PyObject * args, PyObject * kwargs)
     HMODULE openal = LoadLibraryA(PyUnicode_AsUTF8(dll_path));
     Py_DECREF(dll_path);
     if (!openal) {
+        PyMem_Free(cache_path);
         PyErr_BadInternalCall();
         return NULL;
     }
@@ -192,6 +2022,9 @@ static PyObject * meth_init(PyObject * self, PyObject * args, PyObject * kwargs)
     *(PROC *)&alcMakeContextCurrent = GetProcAddress(openal, "alcMakeContextCurrent");
     *(PROC *)&alcOpenDevice = GetProcAddress(openal, "alcOpenDevice");
     *(PROC *)&alcCloseDevice = GetProcAddress(openal, "alcCloseDevice");
+    *(PROC *)&alcDestroyContext = GetProcAddress(openal, "alcDestroyContext");
+    *(PROC *)&alcSuspendContext = GetProcAddress(openal, "alcSuspendContext");
+    *(PROC *)&alcProcessContext = GetProcAddress(openal, "alcProcessContext");
 
     *(PROC *)&alListenerfv = GetProcAddress(openal, "alListenerfv");
     *(PROC *)&alListenerf = GetProcAddress(openal, "alListenerf");
@@ -208,229 +2041,1412 @@ static PyObject * meth_init(PyObject * self, PyObject * args, PyObject * kwargs)
 
     *(PROC *)&alGetSourcei = GetProcAddress(openal, "alGetSourcei");
     *(PROC *)&alSourcePlay = GetProcAddress(openal, "alSourcePlay");
+    *(PROC *)&alSourcePlayv = GetProcAddress(openal, "alSourcePlayv");
     *(PROC *)&alSourceStop = GetProcAddress(openal, "alSourceStop");
     *(PROC *)&alSourcePause = GetProcAddress(openal, "alSourcePause");
+    *(PROC *)&alSourceQueueBuffers = GetProcAddress(openal, "alSourceQueueBuffers");
+    *(PROC *)&alSourceUnqueueBuffers = GetProcAddress(openal, "alSourceUnqueueBuffers");
+
+    *(PROC *)&alIsExtensionPresent = GetProcAddress(openal, "alIsExtensionPresent");
+    *(PROC *)&alGetProcAddress = GetProcAddress(openal, "alGetProcAddress");
 
     device = alcOpenDevice(NULL);
     if (!device) {
+        PyMem_Free(cache_path);
         PyErr_BadInternalCall();
         return NULL;
     }
 
-    context = alcCreateContext(device, NULL);
-    if (!context) {
-        PyErr_BadInternalCall();
-        return NULL;
+    context = alcCreateContext(device, NULL);
+    if (!context) {
+        close_device();
+        PyMem_Free(cache_path);
+        PyErr_BadInternalCall();
+        return NULL;
+    }
+
+    alcMakeContextCurrent(context);
+
+    source_pool = (int *)PyMem_Calloc(sources, sizeof(int));
+    alGenSources(sources, source_pool);
+    if (!source_pool[sources - 1]) {
+        PyMem_Free(source_pool);
+        source_pool = NULL;
+        close_device();
+        PyMem_Free(cache_path);
+        PyErr_SetString(PyExc_RuntimeError, "failed to allocate sources");
+        return NULL;
+    }
+
+    source_pool_size = sources;
+    source_pool_free = sources;
+
+    /* Pool threads read the cache directory without the GIL. It is set once by
+    the only successful init(), tasks upload to the context and need it first. */
+    cache.budget = cache_budget;
+    pcm_cache_dir = cache_path;
+    if (pcm_cache_dir) {
+        CreateDirectoryW(pcm_cache_dir, NULL);
+    }
+
+    voices.count = 0;
+    voices.source = (int *)PyMem_Malloc(sources * sizeof(int));
+    voices.buffer = (Buffer **)PyMem_Malloc(sources * sizeof(Buffer *));
+    voices.object = (Source **)PyMem_Malloc(sources * sizeof(Source *));
+    voices.state = (int *)PyMem_Malloc(sources * sizeof(int));
+    voices.priority = (int *)PyMem_Malloc(sources * sizeof(int));
+
+    source_mask = 1;
+    while (source_mask < sources * 2) {
+        source_mask *= 2;
+    }
+    source_keys = (int *)PyMem_Calloc(source_mask, sizeof(int));
+    source_voices = (int *)PyMem_Malloc(source_mask * sizeof(int));
+    source_mask -= 1;
+    for (int i = 0; i < sources; ++i) {
+        int j = (int)((unsigned)source_pool[i] * 2654435761u) & source_mask;
+        while (source_keys[j]) {
+            j = (j + 1) & source_mask;
+        }
+        source_keys[j] = source_pool[i];
+        source_voices[j] = -1;
+    }
+
+    if (alIsExtensionPresent("AL_SOFT_deferred_updates")) {
+        *(void **)&alDeferUpdatesSOFT = alGetProcAddress("alDeferUpdatesSOFT");
+        *(void **)&alProcessUpdatesSOFT = alGetProcAddress("alProcessUpdatesSOFT");
+    }
+
+    use_events = alIsExtensionPresent("AL_SOFT_events");
+    if (use_events) {
+        *(void **)&alEventControlSOFT = alGetProcAddress("alEventControlSOFT");
+        *(void **)&alEventCallbackSOFT = alGetProcAddress("alEventCallbackSOFT");
+        stopped.mask = source_mask;
+        stopped.items = (int *)PyMem_Malloc((source_mask + 1) * sizeof(int));
+        stopped.head = 0;
+        stopped.tail = 0;
+        stopped.overflow = 0;
+        int types[] = {AL_EVENT_TYPE_SOURCE_STATE_CHANGED_SOFT};
+        alEventCallbackSOFT(event_callback, NULL);
+        alEventControlSOFT(1, types, true);
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject * meth_update(PyObject * self, PyObject * args, PyObject * kwargs) {
+    const char * keywords[] = {"position", "velocity", "direction", "up", "gain", NULL};
+
+    int args_ok = PyArg_ParseTupleAndKeywords(
+        args, kwargs, "|(fff)(fff)(fff)(fff)f", (char **)keywords,
+        &listener.position[0], &listener.position[1], &listener.position[2],
+        &listener.velocity[0], &listener.velocity[1], &listener.velocity[2],
+        &listener.orientation[0], &listener.orientation[1], &listener.orientation[2],
+        &listener.orientation[3], &listener.orientation[4], &listener.orientation[5],
+        &listener.gain
+    );
+
+    if (!args_ok) {
+        return NULL;
+    }
+
+    drain_tasks();
+    reap_streams(false);
+
+    begin_batch();
+    alListenerfv(AL_POSITION, listener.position);
+    alListenerfv(AL_VELOCITY, listener.velocity);
+    alListenerfv(AL_ORIENTATION, listener.orientation);
+    alListenerf(AL_GAIN, listener.gain);
+
+    if (use_events && !InterlockedExchange(&stopped.overflow, 0)) {
+        LONG tail = stopped.tail;
+        for (LONG head = stopped.head; head != tail; ++head) {
+            int * voice = source_voice(stopped.items[head & stopped.mask]);
+            if (voice && *voice >= 0) {
+                int state = 0;
+                alGetSourcei(voices.source[*voice], AL_SOURCE_STATE, &state);
+                if (state == AL_STOPPED) {
+                    reap_voice(*voice);
+                }
+            }
+        }
+        InterlockedExchange(&stopped.head, tail);
+        trim_cache();
+        end_batch();
+        Py_RETURN_NONE;
+    }
+
+    if (use_events) {
+        InterlockedExchange(&stopped.head, stopped.tail);
+    }
+
+    int i = 0;
+    while (i < voices.count) {
+        int state = 0;
+        alGetSourcei(voices.source[i], AL_SOURCE_STATE, &state);
+        if (state == AL_STOPPED) {
+            reap_voice(i);
+        } else {
+            voices.state[i++] = state;
+        }
+    }
+    trim_cache();
+    end_batch();
+    Py_RETURN_NONE;
+}
+
+static PyObject * meth_cache_stats(PyObject * self, PyObject * args) {
+    return Py_BuildValue(
+        "{sLsLsLsLsL}",
+        "hits", cache.hits,
+        "misses", cache.misses,
+        "evictions", cache.evictions,
+        "bytes", cache.bytes,
+        "budget", cache.budget
+    );
+}
+
+static PyObject * meth_pause(PyObject * self, PyObject * args) {
+    for (int i = 0; i < voices.count; ++i) {
+        if (voices.state[i] == AL_PLAYING) {
+            alSourcePause(voices.source[i]);
+            voices.state[i] = AL_PAUSED;
+        }
+    }
+    AcquireSRWLockExclusive(&stream_lock);
+    for (Stream * stream = streams; stream; stream = stream->next) {
+        if (stream->state == AL_PLAYING) {
+            alSourcePause(stream->source);
+            stream->state = AL_PAUSED;
+        }
+    }
+    ReleaseSRWLockExclusive(&stream_lock);
+    Py_RETURN_NONE;
+}
+
+/* The tracked state is only refreshed by update(), a voice that stopped since
+then is still tracked as playing or paused. Playing it again would restart it. */
+
+static void resume_voice(int voice) {
+    int state = 0;
+    alGetSourcei(voices.source[voice], AL_SOURCE_STATE, &state);
+    if (state == AL_PAUSED) {
+        alSourcePlay(voices.source[voice]);
+        state = AL_PLAYING;
+    }
+    voices.state[voice] = state;
+}
+
+static PyObject * meth_resume(PyObject * self, PyObject * args) {
+    for (int i = 0; i < voices.count; ++i) {
+        if (voices.state[i] == AL_PAUSED) {
+            resume_voice(i);
+        }
+    }
+    AcquireSRWLockExclusive(&stream_lock);
+    for (Stream * stream = streams; stream; stream = stream->next) {
+        if (stream->state == AL_PAUSED) {
+            alSourcePlay(stream->source);
+            stream->state = AL_PLAYING;
+        }
+    }
+    ReleaseSRWLockExclusive(&stream_lock);
+    Py_RETURN_NONE;
+}
+
+static void release_input(FileMap * file, Py_buffer * view, wchar_t * path) {
+    unmap_file(file);
+    if (view->buf) {
+        PyBuffer_Release(view);
+    }
+    PyMem_Free(path);
+}
+
+/* Paths and buffers holding QOA or Ogg Vorbis data are decoded natively, the
+helper only runs for tuples, paths soundbox can not map and anything else it
+can load that soundbox can not. Its errors are raised as they are. */
+
+static PyObject * meth_load(PyObject * self, PyObject * args, PyObject * kwargs) {
+    const char * keywords[] = {"name", "data", NULL};
+
+    PyObject * name;
+    PyObject * data;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO", (char **)keywords, &name, &data)) {
+        return NULL;
+    }
+
+    FileMap file = {};
+    Py_buffer view = {};
+    wchar_t * path = NULL;
+    if (PyUnicode_Check(data)) {
+        path = PyUnicode_AsWideCharString(data, NULL);
+        if (!path) {
+            return NULL;
+        }
+        if (!map_file(path, &file)) {
+            PyMem_Free(path);
+            path = NULL;
+        }
+    } else if (PyObject_CheckBuffer(data) && PyObject_GetBuffer(data, &view, PyBUF_SIMPLE) < 0) {
+        return NULL;
+    }
+
+    const unsigned char * ptr = file.data ? file.data : (const unsigned char *)view.buf;
+    int size = file.data ? file.size : (int)view.len;
+    unsigned long long check = 0;
+    unsigned long long hash = ptr ? hash_bytes(ptr, size, &check) : 0;
+    Buffer * shared = ptr ? find_shared(hash, check, size) : NULL;
+    bool native = ptr && size >= 4 && (!memcmp(ptr, "qoaf", 4) || !memcmp(ptr, "OggS", 4));
+
+    Pcm pcm = {};
+    if (native && !shared) {
+        bool decoded = false;
+        Py_BEGIN_ALLOW_THREADS
+        decoded = load_pcm(ptr, size, hash, &pcm);
+        Py_END_ALLOW_THREADS
+        if (!decoded) {
+            release_input(&file, &view, path);
+            PyErr_SetString(PyExc_RuntimeError, "failed to decode audio data");
+            return NULL;
+        }
+        shared = find_shared(hash, check, size);
+    }
+
+    if (shared) {
+        free_pcm(&pcm);
+        release_input(&file, &view, path);
+        Buffer * ready = find_buffer((PyObject *)shared, false);
+        if (!ready) {
+            return NULL;
+        }
+        PyDict_SetItem(buffers, name, (PyObject *)ready);
+        Py_DECREF(ready);
+        Py_RETURN_NONE;
+    }
+
+    Buffer * res = NULL;
+    if (native) {
+        int buffer = upload_pcm(pcm.samples, pcm.size, pcm.samplerate, pcm.channels == 2);
+        free_pcm(&pcm);
+        res = add_buffer(name, buffer, pcm.size, pcm.samplerate, pcm.channels == 2);
+        keep_input(res, data, path);
+        path = NULL;
+    } else {
+        PyObject * tup = PyObject_CallMethod(helper, "load", "(OO)", data, self);
+        if (!tup) {
+            release_input(&file, &view, path);
+            return NULL;
+        }
+
+        PyObject * audio_data = PyTuple_GetItem(tup, 0);
+        int samplerate = (int)PyLong_AsLong(PyTuple_GetItem(tup, 1));
+        int stereo = PyObject_IsTrue(PyTuple_GetItem(tup, 2));
+
+        Py_buffer samples = {};
+        if (PyObject_GetBuffer(audio_data, &samples, PyBUF_SIMPLE) < 0) {
+            release_input(&file, &view, path);
+            Py_DECREF(tup);
+            return NULL;
+        }
+
+        /* Raw pcm tuples are keyed on the pcm and its format. */
+        if (!ptr) {
+            size = (int)samples.len;
+            hash = hash_bytes(samples.buf, size, &check) ^ (samplerate * 2 + stereo + 1);
+            shared = find_shared(hash, check, size);
+        }
+
+        if (shared) {
+            PyDict_SetItem(buffers, name, (PyObject *)shared);
+        } else {
+            int buffer = upload_pcm(samples.buf, (int)samples.len, samplerate, stereo);
+            res = add_buffer(name, buffer, (int)samples.len, samplerate, stereo);
+        }
+        PyBuffer_Release(&samples);
+        Py_DECREF(tup);
+    }
+
+    if (res) {
+        share_buffer(res, hash, check, size);
+    }
+    release_input(&file, &view, path);
+    Py_RETURN_NONE;
+}
+
+/* A bank is a single file holding a header, an index sorted by name, the
+names and the compressed payloads. The file stays mapped for as long as any
+of its buffers is alive, every entry is registered as a lazy buffer and
+entries pointing at the same payload share one. */
+
+static PyObject * meth_load_bank(PyObject * self, PyObject * args, PyObject * kwargs) {
+    const char * keywords[] = {"path", NULL};
+
+    PyObject * path_obj;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "U", (char **)keywords, &path_obj)) {
+        return NULL;
+    }
+
+    wchar_t * path = PyUnicode_AsWideCharString(path_obj, NULL);
+    if (!path) {
+        return NULL;
+    }
+
+    Bank * bank = PyObject_New(Bank, Bank_type);
+    bool file_ok = map_file(path, &bank->file);
+    PyMem_Free(path);
+    if (!file_ok) {
+        Py_DECREF(bank);
+        PyErr_SetString(PyExc_OSError, "failed to read file");
+        return NULL;
+    }
+
+    const unsigned char * data = bank->file.data;
+    unsigned int size = bank->file.size;
+    const BankHeader * header = (const BankHeader *)data;
+    const BankEntry * entries = (const BankEntry *)(data + sizeof(BankHeader));
+
+    bool bank_ok = (
+        size >= sizeof(BankHeader) && !memcmp(header->magic, "SBNK", 4) && header->version == 1 &&
+        header->count <= (size - sizeof(BankHeader)) / sizeof(BankEntry) &&
+        header->names_size <= size - sizeof(BankHeader) - header->count * sizeof(BankEntry)
+    );
+
+    for (unsigned int i = 0; bank_ok && i < header->count; ++i) {
+        const BankEntry * entry = &entries[i];
+        bank_ok = (
+            entry->name_offset <= header->names_size && entry->name_length <= header->names_size - entry->name_offset &&
+            entry->offset <= size && entry->length <= size - entry->offset
+        );
+    }
+
+    if (!bank_ok) {
+        Py_DECREF(bank);
+        PyErr_SetString(PyExc_ValueError, "invalid bank");
+        return NULL;
+    }
+
+    const char * names = (const char *)(entries + header->count);
+    PyObject * res = PyList_New(header->count);
+    PyObject * payloads = PyDict_New();
+    for (unsigned int i = 0; i < header->count; ++i) {
+        const BankEntry * entry = &entries[i];
+        PyObject * name = PyUnicode_DecodeUTF8(names + entry->name_offset, entry->name_length, NULL);
+        if (!name) {
+            Py_DECREF(payloads);
+            Py_DECREF(res);
+            Py_DECREF(bank);
+            return NULL;
+        }
+        PyObject * offset = PyLong_FromUnsignedLong(entry->offset);
+        Buffer * buffer = (Buffer *)PyDict_GetItem(payloads, offset);
+        if (!buffer) {
+            buffer = new_buffer(0, 0, entry->samplerate, entry->channels == 2);
+            buffer->data = data + entry->offset;
+            buffer->data_size = entry->length;
+            buffer->owner = (PyObject *)bank;
+            Py_INCREF(bank);
+            PyDict_SetItem(payloads, offset, (PyObject *)buffer);
+            Py_DECREF(buffer);
+        }
+        PyDict_SetItem(buffers, name, (PyObject *)buffer);
+        PyList_SET_ITEM(res, i, name);
+        Py_DECREF(offset);
+    }
+
+    Py_DECREF(payloads);
+    Py_DECREF(bank);
+    return res;
+}
+
+static PyObject * meth_register(PyObject * self, PyObject * args, PyObject * kwargs) {
+    const char * keywords[] = {"name", "data", "lazy", NULL};
+
+    PyObject * name;
+    PyObject * data;
+    int lazy = true;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|p", (char **)keywords, &name, &data, &lazy)) {
+        return NULL;
+    }
+
+    Buffer * buffer = new_buffer(0, 0, 0, 0);
+
+    if (PyUnicode_Check(data)) {
+        buffer->path = PyUnicode_AsWideCharString(data, NULL);
+    } else {
+        if (PyBytes_Check(data)) {
+            Py_INCREF(data);
+        }
+        buffer->owner = PyBytes_Check(data) ? data : PyBytes_FromObject(data);
+        if (buffer->owner) {
+            buffer->data = (const unsigned char *)PyBytes_AS_STRING(buffer->owner);
+            buffer->data_size = (int)PyBytes_GET_SIZE(buffer->owner);
+        }
+    }
+
+    if (!buffer->path && !buffer->owner) {
+        Py_DECREF(buffer);
+        return NULL;
+    }
+
+    if (buffer->owner) {
+        unsigned long long check = 0;
+        unsigned long long hash = hash_bytes(buffer->data, buffer->data_size, &check);
+        if (Buffer * shared = find_shared(hash, check, buffer->data_size)) {
+            Py_DECREF(buffer);
+            buffer = shared;
+            Py_INCREF(buffer);
+        } else {
+            share_buffer(buffer, hash, check, buffer->data_size);
+        }
+    }
+
+    Buffer * ready = lazy ? NULL : find_buffer((PyObject *)buffer, false);
+    if (!lazy && !ready) {
+        Py_DECREF(buffer);
+        return NULL;
+    }
+    Py_XDECREF(ready);
+
+    PyDict_SetItem(buffers, name, (PyObject *)buffer);
+    Py_DECREF(buffer);
+    Py_RETURN_NONE;
+}
+
+static PyObject * meth_prefetch(PyObject * self, PyObject * args, PyObject * kwargs) {
+    const char * keywords[] = {"names", NULL};
+
+    PyObject * names;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O", (char **)keywords, &names)) {
+        return NULL;
+    }
+
+    PyObject * seq = PySequence_Fast(names, "names must be a sequence");
+    if (!seq) {
+        return NULL;
+    }
+
+    int count = (int)PySequence_Fast_GET_SIZE(seq);
+    for (int i = 0; i < count; ++i) {
+        PyObject * name = PySequence_Fast_GET_ITEM(seq, i);
+        Buffer * buffer = Py_TYPE(name) == Buffer_type ? (Buffer *)name : (Buffer *)PyDict_GetItem(buffers, name);
+        if (!buffer) {
+            Py_DECREF(seq);
+            PyErr_SetString(PyExc_KeyError, "buffer not found");
+            return NULL;
+        }
+        if (InterlockedCompareExchange(&buffer->state, BUFFER_LOADING, BUFFER_COLD) != BUFFER_COLD) {
+            continue;
+        }
+        Py_INCREF(buffer);
+        if (!TrySubmitThreadpoolCallback(prefetch_worker, buffer, NULL)) {
+            InterlockedExchange(&buffer->state, BUFFER_COLD);
+            Py_DECREF(buffer);
+            Py_DECREF(seq);
+            PyErr_SetString(PyExc_RuntimeError, "failed to submit task");
+            return NULL;
+        }
+    }
+
+    Py_DECREF(seq);
+    Py_RETURN_NONE;
+}
+
+/* Lists the audio files in a directory, or the files matching a wildcard
+pattern, as a dict of name to path. Names are file names without the
+extension. */
+
+static PyObject * find_files(PyObject * pattern) {
+    wchar_t * path = PyUnicode_AsWideCharString(pattern, NULL);
+    if (!path) {
+        return NULL;
+    }
+
+    DWORD attributes = GetFileAttributesW(path);
+    bool directory = attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+
+    int dir_len = directory ? (int)wcslen(path) : 0;
+    for (int i = 0; !directory && path[i]; ++i) {
+        if (path[i] == L'\\' || path[i] == L'/') {
+            dir_len = i + 1;
+        }
+    }
+
+    wchar_t search[1024];
+    if (swprintf(search, 1024, directory ? L"%ls\\*" : L"%ls", path) < 0) {
+        PyMem_Free(path);
+        PyErr_SetString(PyExc_ValueError, "path too long");
+        return NULL;
+    }
+
+    WIN32_FIND_DATAW found;
+    HANDLE find = FindFirstFileW(search, &found);
+    if (find == INVALID_HANDLE_VALUE) {
+        PyMem_Free(path);
+        PyErr_Format(PyExc_FileNotFoundError, "no files found for %R", pattern);
+        return NULL;
+    }
+
+    PyObject * res = PyDict_New();
+    do {
+        const wchar_t * ext = wcsrchr(found.cFileName, L'.');
+        bool audio = ext && (!_wcsicmp(ext, L".ogg") || !_wcsicmp(ext, L".qoa"));
+        if ((found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) || (!audio && directory)) {
+            continue;
+        }
+        wchar_t full[1024];
+        if (swprintf(full, 1024, L"%.*ls%ls%ls", dir_len, path, directory ? L"\\" : L"", found.cFileName) < 0) {
+            PyErr_SetString(PyExc_ValueError, "path too long");
+            Py_CLEAR(res);
+            break;
+        }
+        PyObject * name = PyUnicode_FromWideChar(found.cFileName, ext ? ext - found.cFileName : -1);
+        if (PyDict_GetItem(res, name)) {
+            PyErr_Format(PyExc_ValueError, "duplicate name %R", name);
+            Py_DECREF(name);
+            Py_CLEAR(res);
+            break;
+        }
+        PyObject * value = PyUnicode_FromWideChar(full, -1);
+        PyDict_SetItem(res, name, value);
+        Py_DECREF(name);
+        Py_DECREF(value);
+    } while (FindNextFileW(find, &found));
+
+    FindClose(find);
+    PyMem_Free(path);
+    return res;
+}
+
+/* Maps and hashes the input, items already loaded under another name are
+shared instead of decoded. */
+
+static void load_many_hash(void * arg, int index) {
+    LoadItem * item = (LoadItem *)arg + index;
+    if (item->error) {
+        return;
+    }
+
+    if (item->path && !map_file(item->path, &item->file)) {
+        item->error = "failed to read file";
+        return;
+    }
+
+    item->data = item->path ? item->file.data : (const unsigned char *)item->view.buf;
+    item->size = item->path ? item->file.size : (int)item->view.len;
+    item->hash = hash_bytes(item->data, item->size, &item->check);
+}
+
+static void load_many_job(void * arg, int index) {
+    LoadItem * item = (LoadItem *)arg + index;
+    if (!item->error && !item->shared && !load_pcm(item->data, item->size, item->hash, &item->pcm)) {
+        item->error = "failed to decode audio data";
+    }
+}
+
+/* Decodes every item on the thread pool without the GIL, then uploads and
+registers the results. Failures are returned as a dict of name to error, a
+pattern matching nothing raises. */
+
+static PyObject * meth_load_many(PyObject * self, PyObject * args, PyObject * kwargs) {
+    const char * keywords[] = {"items", "threads", NULL};
+
+    PyObject * items;
+    int threads = 1;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|i", (char **)keywords, &items, &threads)) {
+        return NULL;
+    }
+
+    PyObject * mapping = PyUnicode_Check(items) ? find_files(items) : PyDict_New();
+    if (!mapping || (!PyUnicode_Check(items) && PyDict_Update(mapping, items) < 0)) {
+        Py_XDECREF(mapping);
+        return NULL;
+    }
+
+    int count = (int)PyDict_Size(mapping);
+    LoadItem * list = (LoadItem *)PyMem_Calloc(count ? count : 1, sizeof(LoadItem));
+
+    Py_ssize_t pos = 0;
+    PyObject * name;
+    PyObject * data;
+    for (int i = 0; PyDict_Next(mapping, &pos, &name, &data); ++i) {
+        LoadItem * item = &list[i];
+        item->name = name;
+        if (PyUnicode_Check(data)) {
+            item->path = PyUnicode_AsWideCharString(data, NULL);
+        } else if (PyObject_CheckBuffer(data)) {
+            PyObject_GetBuffer(data, &item->view, PyBUF_SIMPLE);
+        }
+        if (!item->path && !item->view.buf) {
+            PyErr_Clear();
+            item->error = "data must be a path or a buffer";
+        }
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    parallel_for(count, threads, load_many_hash, list);
+    Py_END_ALLOW_THREADS
+
+    for (int i = 0; i < count; ++i) {
+        LoadItem * item = &list[i];
+        item->shared = item->error ? NULL : find_shared(item->hash, item->check, item->size);
+        Py_XINCREF(item->shared);
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    parallel_for(count, threads, load_many_job, list);
+    Py_END_ALLOW_THREADS
+
+    PyObject * errors = PyDict_New();
+    for (int i = 0; i < count; ++i) {
+        LoadItem * item = &list[i];
+        if (!item->error) {
+            Buffer * shared = item->shared ? item->shared : find_shared(item->hash, item->check, item->size);
+            Buffer * ready = shared ? find_buffer((PyObject *)shared, false) : NULL;
+            if (ready) {
+                PyDict_SetItem(buffers, item->name, (PyObject *)ready);
+                Py_DECREF(ready);
+            } else if (!shared) {
+                Pcm * pcm = &item->pcm;
+                int buffer = upload_pcm(pcm->samples, pcm->size, pcm->samplerate, pcm->channels == 2);
+                Buffer * res = add_buffer(item->name, buffer, pcm->size, pcm->samplerate, pcm->channels == 2);
+                share_buffer(res, item->hash, item->check, item->size);
+                keep_input(res, item->view.obj, item->path);
+                item->path = NULL;
+            } else {
+                PyErr_Clear();
+                item->error = "failed to decode audio data";
+            }
+        }
+        if (item->error) {
+            PyObject * error = PyUnicode_FromString(item->error);
+            PyDict_SetItem(errors, item->name, error);
+            Py_DECREF(error);
+        }
+        if (item->pcm.samples) {
+            free_pcm(&item->pcm);
+        }
+        Py_XDECREF(item->shared);
+        unmap_file(&item->file);
+        if (item->view.buf) {
+            PyBuffer_Release(&item->view);
+        }
+        PyMem_Free(item->path);
+    }
+
+    PyMem_Free(list);
+    Py_DECREF(mapping);
+    return errors;
+}
+
+static Task * meth_load_async(PyObject * self, PyObject * args, PyObject * kwargs) {
+    const char * keywords[] = {"name", "data", "callback", NULL};
+
+    PyObject * name;
+    PyObject * data;
+    PyObject * callback = Py_None;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|O", (char **)keywords, &name, &data, &callback)) {
+        return NULL;
+    }
+
+    Task * task = PyObject_New(Task, Task_type);
+    task->next = NULL;
+    task->name = name;
+    task->data = data;
+    task->callback = callback;
+    task->path = NULL;
+    task->view.buf = NULL;
+    task->event = CreateEventA(NULL, true, false, NULL);
+    task->done = 0;
+    task->finished = false;
+    task->error = NULL;
+    task->buffer = 0;
+    Py_INCREF(name);
+    Py_INCREF(data);
+    Py_INCREF(callback);
+
+    bool args_ok = PyUnicode_Check(data) ?
+        (task->path = PyUnicode_AsWideCharString(data, NULL)) != NULL :
+        PyObject_GetBuffer(data, &task->view, PyBUF_SIMPLE) == 0;
+
+    if (!args_ok) {
+        task->view.buf = NULL;
+        task->finished = true;
+        Py_DECREF(task);
+        return NULL;
+    }
+
+    Py_INCREF(task);
+    if (!TrySubmitThreadpoolCallback(task_worker, task, NULL)) {
+        Py_DECREF(task);
+        Py_DECREF(task);
+        PyErr_SetString(PyExc_RuntimeError, "failed to submit task");
+        return NULL;
+    }
+    return task;
+}
+
+static PyObject * meth_unload(PyObject * self, PyObject * args, PyObject * kwargs) {
+    const char * keywords[] = {"name", NULL};
+
+    PyObject * name;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O", (char **)keywords, &name)) {
+        return NULL;
+    }
+
+    PyDict_DelItem(buffers, name);
+    Py_RETURN_NONE;
+}
+
+static Source * meth_play(PyObject * self, PyObject * args, PyObject * kwargs) {
+    const char * keywords[] = {
+        "name", "position", "velocity", "direction", "pitch", "gain", "relative", "loop", "priority", NULL,
+    };
+
+    PyObject * name;
+    float position[3] = {0.0f, 0.0f, 0.0f};
+    float velocity[3] = {0.0f, 0.0f, 0.0f};
+    float direction[3] = {0.0f, 0.0f, 0.0f};
+    float pitch = 1.0f;
+    float gain = 1.0f;
+    int relative = false;
+    int loop = false;
+    int priority = 0;
+
+    int args_ok = PyArg_ParseTupleAndKeywords(
+        args, kwargs, "O|(fff)(fff)(fff)ffppi", (char **)keywords,
+        &name,
+        &position[0], &position[1], &position[2],
+        &velocity[0], &velocity[1], &velocity[2],
+        &direction[0], &direction[1], &direction[2],
+        &pitch,
+        &gain,
+        &relative,
+        &loop,
+        &priority
+    );
+
+    if (!args_ok) {
+        return NULL;
+    }
+
+    Buffer * buffer = find_buffer(name, true);
+    if (!buffer) {
+        return NULL;
+    }
+
+    begin_batch();
+    Source * res = start_voice(buffer, priority);
+    Py_DECREF(buffer);
+    if (!res) {
+        end_batch();
+        return NULL;
+    }
+
+    int source = voices.source[res->voice];
+    alSourcefv(source, AL_POSITION, position);
+    alSourcefv(source, AL_VELOCITY, velocity);
+    alSourcefv(source, AL_DIRECTION, direction);
+    alSourcef(source, AL_PITCH, pitch);
+    alSourcef(source, AL_GAIN, gain);
+    alSourcei(source, AL_SOURCE_RELATIVE, relative);
+    alSourcei(source, AL_LOOPING, loop);
+    alSourcePlay(source);
+    end_batch();
+    return res;
+}
+
+static void release_buffers(Buffer ** list, int count) {
+    for (int i = 0; i < count; ++i) {
+        Py_DECREF(list[i]);
     }
-
-    alcMakeContextCurrent(context);
-    Py_RETURN_NONE;
+    PyMem_Free(list);
 }
 
-static PyObject * meth_update(PyObject * self, PyObject * args, PyObject * kwargs) {
-    const char * keywords[] = {"position", "velocity", "direction", "up", "gain", NULL};
+static PyObject * meth_play_many(PyObject * self, PyObject * args, PyObject * kwargs) {
+    const char * keywords[] = {
+        "names", "positions", "velocities", "directions", "pitches", "gains", "relative", "loop", "priority", NULL,
+    };
+
+    PyObject * names;
+    PyObject * positions = Py_None;
+    PyObject * velocities = Py_None;
+    PyObject * directions = Py_None;
+    PyObject * pitches = Py_None;
+    PyObject * gains = Py_None;
+    int relative = false;
+    int loop = false;
+    int priority = 0;
 
     int args_ok = PyArg_ParseTupleAndKeywords(
-        args, kwargs, "|(fff)(fff)(fff)(fff)f", (char **)keywords,
-        &listener.position[0], &listener.position[1], &listener.position[2],
-        &listener.velocity[0], &listener.velocity[1], &listener.velocity[2],
-        &listener.orientation[0], &listener.orientation[1], &listener.orientation[2],
-        &listener.orientation[3], &listener.orientation[4], &listener.orientation[5],
-        &listener.gain
+        args, kwargs, "O|OOOOOppi", (char **)keywords,
+        &names, &positions, &velocities, &directions, &pitches, &gains, &relative, &loop, &priority
     );
 
     if (!args_ok) {
         return NULL;
     }
 
-    alListenerfv(AL_POSITION, listener.position);
-    alListenerfv(AL_VELOCITY, listener.velocity);
-    alListenerfv(AL_ORIENTATION, listener.orientation);
-    alListenerf(AL_GAIN, listener.gain);
+    /* A tuple copy, find_buffer() may drop the GIL and the list could change. */
+    PyObject * seq = PySequence_Tuple(names);
+    if (!seq) {
+        return NULL;
+    }
 
-    Source ** ptr = &playing;
-    while (Source * source = *ptr) {
-        int state = 0;
-        alGetSourcei(source->source, AL_SOURCE_STATE, &state);
-        if (state == AL_STOPPED) {
-            alSourcei(source->source, AL_BUFFER, 0);
-            Py_DECREF(source->buffer);
-            source->buffer = NULL;
-            Source * next = source->next;
-            source->next = NULL;
-            Py_DECREF(source);
-            *ptr = next;
-        } else {
-            ptr = &source->next;
+    int count = (int)PySequence_Fast_GET_SIZE(seq);
+    int found_count = count;
+    PyObject ** items = PySequence_Fast_ITEMS(seq);
+
+    Py_buffer views[5] = {};
+    bool views_ok = (
+        get_floats(positions, &views[0], count * 3, "positions") &&
+        get_floats(velocities, &views[1], count * 3, "velocities") &&
+        get_floats(directions, &views[2], count * 3, "directions") &&
+        get_floats(pitches, &views[3], count, "pitches") &&
+        get_floats(gains, &views[4], count, "gains")
+    );
+
+    /* The buffers found and the sources started share one block. */
+    PyObject * res = views_ok ? PyTuple_New(count) : NULL;
+    Buffer ** found = res ? (Buffer **)PyMem_Calloc(count ? count : 1, sizeof(Buffer *) + sizeof(int)) : NULL;
+    int * sources = found ? (int *)(found + count) : NULL;
+
+    for (int i = 0; found && i < count; ++i) {
+        if (!(found[i] = find_buffer(items[i], true))) {
+            release_buffers(found, i);
+            found = NULL;
         }
     }
-    Py_RETURN_NONE;
-}
 
-static PyObject * meth_pause(PyObject * self, PyObject * args) {
-    Source * source = playing;
-    while (source) {
-        alSourcePause(source->source);
-        source = source->next;
+    if (!found) {
+        Py_XDECREF(res);
+        for (int i = 0; i < 5; ++i) {
+            release_floats(&views[i]);
+        }
+        Py_DECREF(seq);
+        return NULL;
     }
-    Py_RETURN_NONE;
-}
 
-static PyObject * meth_resume(PyObject * self, PyObject * args) {
-    Source * source = playing;
-    while (source) {
-        int state = 0;
-        alGetSourcei(source->source, AL_SOURCE_STATE, &state);
-        if (state == AL_PAUSED) {
-            alSourcePlay(source->source);
+    const float zero[3] = {0.0f, 0.0f, 0.0f};
+    const float * position = (const float *)views[0].buf;
+    const float * velocity = (const float *)views[1].buf;
+    const float * direction = (const float *)views[2].buf;
+    const float * pitch = (const float *)views[3].buf;
+    const float * gain = (const float *)views[4].buf;
+
+    begin_batch();
+    for (int i = 0; i < count; ++i) {
+        Source * source = start_voice(found[i], priority);
+        if (!source) {
+            for (int j = i - 1; j >= 0; --j) {
+                reap_voice(((Source *)PyTuple_GET_ITEM(res, j))->voice);
+            }
+            end_batch();
+            count = 0;
+            Py_CLEAR(res);
+            break;
         }
-        source = source->next;
+        sources[i] = voices.source[source->voice];
+        alSourcefv(sources[i], AL_POSITION, position ? position + i * 3 : zero);
+        alSourcefv(sources[i], AL_VELOCITY, velocity ? velocity + i * 3 : zero);
+        alSourcefv(sources[i], AL_DIRECTION, direction ? direction + i * 3 : zero);
+        alSourcef(sources[i], AL_PITCH, pitch ? pitch[i] : 1.0f);
+        alSourcef(sources[i], AL_GAIN, gain ? gain[i] : 1.0f);
+        alSourcei(sources[i], AL_SOURCE_RELATIVE, relative);
+        alSourcei(sources[i], AL_LOOPING, loop);
+        PyTuple_SET_ITEM(res, i, (PyObject *)source);
     }
-    Py_RETURN_NONE;
-}
 
-static PyObject * meth_load(PyObject * self, PyObject * args, PyObject * kwargs) {
-    const char * keywords[] = {"name", "data", NULL};
+    if (res) {
+        alSourcePlayv(count, sources);
+        end_batch();
+    }
 
-    PyObject * name;
-    PyObject * data;
+    release_buffers(found, found_count);
+    for (int i = 0; i < 5; ++i) {
+        release_floats(&views[i]);
+    }
+    Py_DECREF(seq);
+    return res;
+}
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO", (char **)keywords, &name, &data)) {
+static PyObject * set_sources(PyObject * sources, PyObject * positions, PyObject * velocities, PyObject * pitches, PyObject * gains) {
+    PyObject * seq = PySequence_Fast(sources, "sources must be a sequence");
+    if (!seq) {
         return NULL;
     }
 
-    PyObject * tup = PyObject_CallMethod(helper, "load", "(OO)", data, self);
-    if (!tup) {
-        return NULL;
+    int count = (int)PySequence_Fast_GET_SIZE(seq);
+    PyObject ** items = PySequence_Fast_ITEMS(seq);
+
+    bool args_ok = true;
+    for (int i = 0; args_ok && i < count; ++i) {
+        if (Py_TYPE(items[i]) != Source_type) {
+            PyErr_SetString(PyExc_TypeError, "sources must contain Source objects");
+            args_ok = false;
+        }
     }
 
-    PyObject * audio_data = PyTuple_GetItem(tup, 0);
-    int samplerate = (int)PyLong_AsLong(PyTuple_GetItem(tup, 1));
-    int stereo = PyObject_IsTrue(PyTuple_GetItem(tup, 2));
+    Py_buffer views[4] = {};
+    args_ok = (
+        args_ok &&
+        get_floats(positions, &views[0], count * 3, "positions") &&
+        get_floats(velocities, &views[1], count * 3, "velocities") &&
+        get_floats(pitches, &views[2], count, "pitches") &&
+        get_floats(gains, &views[3], count, "gains")
+    );
 
-    const char * ptr = PyBytes_AsString(audio_data);
-    int size = (int)PyBytes_Size(audio_data);
+    if (args_ok) {
+        const float * position = (const float *)views[0].buf;
+        const float * velocity = (const float *)views[1].buf;
+        const float * pitch = (const float *)views[2].buf;
+        const float * gain = (const float *)views[3].buf;
+
+        begin_batch();
+        for (int i = 0; i < count; ++i) {
+            int voice = ((Source *)items[i])->voice;
+            if (voice < 0) {
+                continue;
+            }
+            int source = voices.source[voice];
+            if (position) {
+                alSourcefv(source, AL_POSITION, position + i * 3);
+            }
+            if (velocity) {
+                alSourcefv(source, AL_VELOCITY, velocity + i * 3);
+            }
+            if (pitch) {
+                alSourcef(source, AL_PITCH, pitch[i]);
+            }
+            if (gain) {
+                alSourcef(source, AL_GAIN, gain[i]);
+            }
+        }
+        end_batch();
+    }
 
-    int buffer = 0;
-    alGenBuffers(1, &buffer);
-    int format = stereo ? AL_FORMAT_STEREO16 : AL_FORMAT_MONO16;
-    alBufferData(buffer, format, ptr, size, samplerate);
+    for (int i = 0; i < 4; ++i) {
+        release_floats(&views[i]);
+    }
+    Py_DECREF(seq);
+    if (!args_ok) {
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
 
-    Buffer * res = PyObject_New(Buffer, Buffer_type);
-    res->buffer = buffer;
-    res->size = size;
-    res->samplerate = samplerate;
-    res->stereo = stereo;
+static PyObject * meth_set_positions(PyObject * self, PyObject * args, PyObject * kwargs) {
+    const char * keywords[] = {"sources", "positions", NULL};
 
-    PyDict_SetItem(buffers, name, (PyObject *)res);
-    Py_DECREF(res);
+    PyObject * sources;
+    PyObject * positions;
 
-    Py_DECREF(tup);
-    Py_RETURN_NONE;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO", (char **)keywords, &sources, &positions)) {
+        return NULL;
+    }
+
+    return set_sources(sources, positions, Py_None, Py_None, Py_None);
 }
 
-static PyObject * meth_unload(PyObject * self, PyObject * args, PyObject * kwargs) {
-    const char * keywords[] = {"name", NULL};
+static PyObject * meth_set_params(PyObject * self, PyObject * args, PyObject * kwargs) {
+    const char * keywords[] = {"sources", "positions", "velocities", "pitches", "gains", NULL};
 
-    PyObject * name;
+    PyObject * sources;
+    PyObject * positions = Py_None;
+    PyObject * velocities = Py_None;
+    PyObject * pitches = Py_None;
+    PyObject * gains = Py_None;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O", (char **)keywords, &name)) {
+    int args_ok = PyArg_ParseTupleAndKeywords(
+        args, kwargs, "O|OOOO", (char **)keywords, &sources, &positions, &velocities, &pitches, &gains
+    );
+
+    if (!args_ok) {
         return NULL;
     }
 
-    PyDict_DelItem(buffers, name);
-    Py_RETURN_NONE;
+    return set_sources(sources, positions, velocities, pitches, gains);
 }
 
-static Source * meth_play(PyObject * self, PyObject * args, PyObject * kwargs) {
-    const char * keywords[] = {
-        "name", "position", "velocity", "direction", "pitch", "gain", "relative", "loop", NULL,
-    };
+static Stream * meth_stream(PyObject * self, PyObject * args, PyObject * kwargs) {
+    const char * keywords[] = {"name_or_path", "position", "velocity", "pitch", "gain", "relative", "loop", "priority", NULL};
 
-    PyObject * name;
+    PyObject * data;
     float position[3] = {0.0f, 0.0f, 0.0f};
     float velocity[3] = {0.0f, 0.0f, 0.0f};
-    float direction[3] = {0.0f, 0.0f, 0.0f};
     float pitch = 1.0f;
     float gain = 1.0f;
-    int relative = false;
+    int relative = true;
     int loop = false;
+    int priority = 0;
 
     int args_ok = PyArg_ParseTupleAndKeywords(
-        args, kwargs, "O|(fff)(fff)(fff)ffpp", (char **)keywords,
-        &name,
+        args, kwargs, "O|(fff)(fff)ffppi", (char **)keywords,
+        &data,
         &position[0], &position[1], &position[2],
         &velocity[0], &velocity[1], &velocity[2],
-        &direction[0], &direction[1], &direction[2],
         &pitch,
         &gain,
         &relative,
-        &loop
+        &loop,
+        &priority
     );
 
     if (!args_ok) {
         return NULL;
     }
 
-    Buffer * buffer = (Buffer *)PyDict_GetItem(buffers, name);
-    if (!buffer) {
-        PyErr_SetString(PyExc_KeyError, "buffer not found");
+    /* A registered or bank name streams from the data the buffer keeps, the
+    stream holds the buffer so unload() cannot free it. */
+    Buffer * buffer = NULL;
+    if (Py_TYPE(data) == Buffer_type) {
+        buffer = (Buffer *)data;
+    } else if (PyUnicode_Check(data)) {
+        buffer = (Buffer *)PyDict_GetItem(buffers, data);
+    }
+    if (buffer) {
+        data = (PyObject *)buffer;
+        if (!buffer->data && !buffer->path) {
+            PyErr_SetString(PyExc_ValueError, "buffer has no compressed data to stream");
+            return NULL;
+        }
+    }
+
+    Stream * res = PyObject_New(Stream, Stream_type);
+    res->next = NULL;
+    res->data = data;
+    res->view.buf = NULL;
+    memset(&res->file, 0, sizeof(FileMap));
+    memset(&res->decoder, 0, sizeof(Decoder));
+    res->source = 0;
+    res->idle_count = 0;
+    res->chunk = NULL;
+    res->state = AL_PLAYING;
+    res->loop = loop;
+    res->eof = false;
+    res->ended = 0;
+    Py_INCREF(data);
+    alGenBuffers(STREAM_BUFFERS, res->buffers);
+
+    const unsigned char * ptr = NULL;
+    int size = 0;
+    if (buffer && buffer->data) {
+        ptr = buffer->data;
+        size = buffer->data_size;
+    } else if (buffer) {
+        if (!map_file(buffer->path, &res->file)) {
+            Py_DECREF(res);
+            PyErr_SetString(PyExc_OSError, "failed to read file");
+            return NULL;
+        }
+        ptr = res->file.data;
+        size = res->file.size;
+    } else if (PyUnicode_Check(data)) {
+        wchar_t * path = PyUnicode_AsWideCharString(data, NULL);
+        if (!path) {
+            Py_DECREF(res);
+            return NULL;
+        }
+        bool file_ok = map_file(path, &res->file);
+        PyMem_Free(path);
+        if (!file_ok) {
+            Py_DECREF(res);
+            PyErr_SetString(PyExc_OSError, "failed to read file");
+            return NULL;
+        }
+        ptr = res->file.data;
+        size = res->file.size;
+    } else {
+        if (PyObject_GetBuffer(data, &res->view, PyBUF_SIMPLE) < 0) {
+            res->view.buf = NULL;
+            Py_DECREF(res);
+            return NULL;
+        }
+        ptr = (const unsigned char *)res->view.buf;
+        size = (int)res->view.len;
+    }
+
+    if (!decoder_open(&res->decoder, ptr, size)) {
+        Py_DECREF(res);
+        PyErr_SetString(PyExc_RuntimeError, "failed to decode audio data");
         return NULL;
     }
 
-    int source = 0;
-    alGenSources(1, &source);
-    alSourcefv(source, AL_POSITION, position);
-    alSourcefv(source, AL_VELOCITY, velocity);
-    alSourcefv(source, AL_DIRECTION, direction);
-    alSourcef(source, AL_PITCH, pitch);
-    alSourcef(source, AL_GAIN, gain);
-    alSourcei(source, AL_SOURCE_RELATIVE, relative);
-    alSourcei(source, AL_LOOPING, loop);
-    alSourcei(source, AL_BUFFER, buffer->buffer);
-    alSourcePlay(source);
+    res->source = alloc_source();
+    if (!res->source) {
+        res->source = steal_source(priority);
+    }
+    if (!res->source) {
+        Py_DECREF(res);
+        PyErr_SetString(PyExc_RuntimeError, "no free sources");
+        return NULL;
+    }
 
-    Source * res = PyObject_New(Source, Source_type);
-    res->next = playing;
-    res->buffer = buffer;
-    res->source = source;
-    playing = res;
+    /* Each buffer holds 100ms, the queue keeps STREAM_BUFFERS of them ahead. */
+    res->chunk_samples = res->decoder.samplerate / 10;
+    res->chunk = (short *)malloc(res->chunk_samples * res->decoder.channels * sizeof(short));
+    for (int i = 0; i < STREAM_BUFFERS; ++i) {
+        res->idle[res->idle_count++] = res->buffers[i];
+    }
+
+    alSourcefv(res->source, AL_POSITION, position);
+    alSourcefv(res->source, AL_VELOCITY, velocity);
+    alSourcef(res->source, AL_PITCH, pitch);
+    alSourcef(res->source, AL_GAIN, gain);
+    alSourcei(res->source, AL_SOURCE_RELATIVE, relative);
+    alSourcei(res->source, AL_LOOPING, false);
+
+    if (!stream_thread) {
+        stream_quit = 0;
+        stream_wake = CreateEventA(NULL, false, false, NULL);
+        stream_thread = CreateThread(NULL, 0, stream_worker, NULL, 0, NULL);
+    }
+
+    AcquireSRWLockExclusive(&stream_lock);
+    refill_stream(res);
+    res->next = streams;
+    streams = res;
     Py_INCREF(res);
+    ReleaseSRWLockExclusive(&stream_lock);
     return res;
 }
 
+static DecodeStream * open_stream(PyTypeObject * type, PyObject * args, PyObject * kwargs, const char * magic, const char * error) {
+    static char * keywords[] = {"data", NULL};
+
+    PyObject * data;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O", keywords, &data)) {
+        return NULL;
+    }
+
+    DecodeStream * res = PyObject_New(DecodeStream, type);
+    res->data = data;
+    res->busy = false;
+    memset(&res->decoder, 0, sizeof(Decoder));
+    Py_INCREF(data);
+
+    if (PyObject_GetBuffer(data, &res->view, PyBUF_SIMPLE) < 0) {
+        res->view.buf = NULL;
+        Py_DECREF(res);
+        return NULL;
+    }
+
+    const unsigned char * ptr = (const unsigned char *)res->view.buf;
+    int size = (int)res->view.len;
+    if (size < 4 || memcmp(ptr, magic, 4) || !decoder_open(&res->decoder, ptr, size)) {
+        Py_DECREF(res);
+        PyErr_SetString(PyExc_RuntimeError, error);
+        return NULL;
+    }
+    return res;
+}
+
+static DecodeStream * meth_ogg_stream(PyObject * self, PyObject * args, PyObject * kwargs) {
+    return open_stream(OggStream_type, args, kwargs, "OggS", "failed to decode ogg data");
+}
+
+static DecodeStream * meth_qoa_stream(PyObject * self, PyObject * args, PyObject * kwargs) {
+    return open_stream(QoaStream_type, args, kwargs, "qoaf", "failed to decode qoa data");
+}
+
 static PyObject * Source_meth_stop(Source * self, PyObject * args) {
-    alSourceStop(self->source);
+    if (self->voice >= 0) {
+        alSourceStop(voices.source[self->voice]);
+    }
     Py_RETURN_NONE;
 }
 
 static PyObject * Source_meth_pause(Source * self, PyObject * args) {
-    alSourcePause(self->source);
+    if (self->voice >= 0 && voices.state[self->voice] == AL_PLAYING) {
+        alSourcePause(voices.source[self->voice]);
+        voices.state[self->voice] = AL_PAUSED;
+    }
     Py_RETURN_NONE;
 }
 
 static PyObject * Source_meth_resume(Source * self, PyObject * args) {
-    int state = 0;
-    alGetSourcei(self->source, AL_SOURCE_STATE, &state);
-    if (state == AL_PAUSED) {
-        alSourcePlay(self->source);
+    if (self->voice >= 0 && voices.state[self->voice] == AL_PAUSED) {
+        resume_voice(self->voice);
     }
     Py_RETURN_NONE;
 }
 
 static PyObject * Source_get_ended(Source * self, void * closure) {
+    if (self->voice < 0) {
+        Py_RETURN_TRUE;
+    }
     int state = 0;
-    alGetSourcei(self->source, AL_SOURCE_STATE, &state);
-    return state == AL_STOPPED ? Py_True : Py_False;
+    alGetSourcei(voices.source[self->voice], AL_SOURCE_STATE, &state);
+    return PyBool_FromLong(state == AL_STOPPED);
+}
+
+static PyObject * Task_meth_wait(Task * self, PyObject * args) {
+    if (!self->done) {
+        Py_BEGIN_ALLOW_THREADS
+        WaitForSingleObject(self->event, INFINITE);
+        Py_END_ALLOW_THREADS
+    }
+    finish_task(self);
+    if (self->error) {
+        PyErr_SetString(PyExc_RuntimeError, self->error);
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject * Task_get_done(Task * self, void * closure) {
+    return PyBool_FromLong(self->done);
+}
+
+static PyObject * Task_get_error(Task * self, void * closure) {
+    if (!self->done || !self->error) {
+        Py_RETURN_NONE;
+    }
+    return PyUnicode_FromString(self->error);
+}
+
+static PyObject * Stream_meth_stop(Stream * self, PyObject * args) {
+    AcquireSRWLockExclusive(&stream_lock);
+    if (!self->ended) {
+        alSourceStop(self->source);
+        self->state = AL_STOPPED;
+        InterlockedExchange(&self->ended, 1);
+    }
+    ReleaseSRWLockExclusive(&stream_lock);
+    Py_RETURN_NONE;
+}
+
+static PyObject * Stream_meth_pause(Stream * self, PyObject * args) {
+    AcquireSRWLockExclusive(&stream_lock);
+    if (!self->ended && self->state == AL_PLAYING) {
+        alSourcePause(self->source);
+        self->state = AL_PAUSED;
+    }
+    ReleaseSRWLockExclusive(&stream_lock);
+    Py_RETURN_NONE;
+}
+
+static PyObject * Stream_meth_resume(Stream * self, PyObject * args) {
+    AcquireSRWLockExclusive(&stream_lock);
+    if (!self->ended && self->state == AL_PAUSED) {
+        alSourcePlay(self->source);
+        self->state = AL_PLAYING;
+    }
+    ReleaseSRWLockExclusive(&stream_lock);
+    Py_RETURN_NONE;
+}
+
+static PyObject * Stream_get_ended(Stream * self, void * closure) {
+    return PyBool_FromLong(self->ended);
+}
+
+/* The decoder runs without the GIL, busy keeps a second thread from using it
+at the same time. */
+
+static PyObject * DecodeStream_meth_read(DecodeStream * self, PyObject * arg) {
+    Py_buffer view;
+    if (PyObject_GetBuffer(arg, &view, PyBUF_WRITABLE) < 0) {
+        return NULL;
+    }
+    if (self->busy) {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_RuntimeError, "stream is in use");
+        return NULL;
+    }
+    self->busy = true;
+    int samples = (int)(view.len / (self->decoder.channels * sizeof(short)));
+    int done = 0;
+    Py_BEGIN_ALLOW_THREADS
+    done = decoder_read(&self->decoder, (short *)view.buf, samples);
+    Py_END_ALLOW_THREADS
+    self->busy = false;
+    PyBuffer_Release(&view);
+    return PyLong_FromLong(done);
+}
+
+static PyObject * DecodeStream_meth_seek(DecodeStream * self, PyObject * arg) {
+    unsigned long sample = PyLong_AsUnsignedLong(arg);
+    if (PyErr_Occurred()) {
+        return NULL;
+    }
+    if (self->busy) {
+        PyErr_SetString(PyExc_RuntimeError, "stream is in use");
+        return NULL;
+    }
+    self->busy = true;
+    bool ok = false;
+    Py_BEGIN_ALLOW_THREADS
+    ok = decoder_seek(&self->decoder, (unsigned int)sample);
+    Py_END_ALLOW_THREADS
+    self->busy = false;
+    if (!ok) {
+        PyErr_SetString(PyExc_ValueError, "failed to seek");
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject * DecodeStream_get_position(DecodeStream * self, void * closure) {
+    return PyLong_FromUnsignedLong(self->decoder.position);
 }
 
 static void Buffer_dealloc(Buffer * self) {
-    alDeleteBuffers(1, &self->buffer);
+    cache_unlink(self);
+    unshare_buffer(self);
+    if (self->buffer) {
+        alDeleteBuffers(1, &self->buffer);
+    }
+    Py_XDECREF(self->owner);
+    PyMem_Free(self->path);
+    Py_TYPE(self)->tp_free(self);
+}
+
+static void Bank_dealloc(Bank * self) {
+    unmap_file(&self->file);
     Py_TYPE(self)->tp_free(self);
 }
 
 static void Source_dealloc(Source * self) {
-    alDeleteSources(1, &self->source);
+    Py_TYPE(self)->tp_free(self);
+}
+
+static void Task_dealloc(Task * self) {
+    if (self->view.buf) {
+        PyBuffer_Release(&self->view);
+    }
+    PyMem_Free(self->path);
+    CloseHandle(self->event);
+    Py_DECREF(self->name);
+    Py_DECREF(self->data);
+    Py_DECREF(self->callback);
+    Py_TYPE(self)->tp_free(self);
+}
+
+static void Stream_dealloc(Stream * self) {
+    alDeleteBuffers(STREAM_BUFFERS, self->buffers);
+    decoder_close(&self->decoder);
+    free(self->chunk);
+    unmap_file(&self->file);
+    if (self->view.buf) {
+        PyBuffer_Release(&self->view);
+    }
+    Py_DECREF(self->data);
+    Py_TYPE(self)->tp_free(self);
+}
+
+static void DecodeStream_dealloc(DecodeStream * self) {
+    decoder_close(&self->decoder);
+    if (self->view.buf) {
+        PyBuffer_Release(&self->view);
+    }
+    Py_DECREF(self->data);
     Py_TYPE(self)->tp_free(self);
 }
 
@@ -439,6 +3455,11 @@ static PyType_Slot Buffer_slots[] = {
     {},
 };
 
+static PyType_Slot Bank_slots[] = {
+    {Py_tp_dealloc, (void *)Bank_dealloc},
+    {},
+};
+
 static PyMethodDef Source_methods[] = {
     {"stop", (PyCFunction)Source_meth_stop, METH_NOARGS},
     {"pause", (PyCFunction)Source_meth_pause, METH_NOARGS},
@@ -465,28 +3486,141 @@ static PyType_Slot Source_slots[] = {
     {},
 };
 
+static PyMethodDef Task_methods[] = {
+    {"wait", (PyCFunction)Task_meth_wait, METH_NOARGS},
+    {},
+};
+
+static PyMemberDef Task_members[] = {
+    {"name", T_OBJECT, offsetof(Task, name), READONLY},
+    {},
+};
+
+static PyGetSetDef Task_getset[] = {
+    {"done", (getter)Task_get_done, NULL},
+    {"error", (getter)Task_get_error, NULL},
+    {},
+};
+
+static PyType_Slot Task_slots[] = {
+    {Py_tp_methods, Task_methods},
+    {Py_tp_members, Task_members},
+    {Py_tp_getset, Task_getset},
+    {Py_tp_dealloc, (void *)Task_dealloc},
+    {},
+};
+
+static PyMethodDef Stream_methods[] = {
+    {"stop", (PyCFunction)Stream_meth_stop, METH_NOARGS},
+    {"pause", (PyCFunction)Stream_meth_pause, METH_NOARGS},
+    {"resume", (PyCFunction)Stream_meth_resume, METH_NOARGS},
+    {},
+};
+
+static PyGetSetDef Stream_getset[] = {
+    {"ended", (getter)Stream_get_ended, NULL},
+    {},
+};
+
+static PyType_Slot Stream_slots[] = {
+    {Py_tp_methods, Stream_methods},
+    {Py_tp_getset, Stream_getset},
+    {Py_tp_dealloc, (void *)Stream_dealloc},
+    {},
+};
+
+static PyMethodDef DecodeStream_methods[] = {
+    {"read", (PyCFunction)DecodeStream_meth_read, METH_O},
+    {"seek", (PyCFunction)DecodeStream_meth_seek, METH_O},
+    {},
+};
+
+static PyMemberDef DecodeStream_members[] = {
+    {"samplerate", T_INT, offsetof(DecodeStream, decoder.samplerate), READONLY},
+    {"channels", T_INT, offsetof(DecodeStream, decoder.channels), READONLY},
+    {"samples", T_UINT, offsetof(DecodeStream, decoder.samples), READONLY},
+    {},
+};
+
+static PyGetSetDef DecodeStream_getset[] = {
+    {"position", (getter)DecodeStream_get_position, NULL},
+    {},
+};
+
+static PyType_Slot DecodeStream_slots[] = {
+    {Py_tp_methods, DecodeStream_methods},
+    {Py_tp_members, DecodeStream_members},
+    {Py_tp_getset, DecodeStream_getset},
+    {Py_tp_dealloc, (void *)DecodeStream_dealloc},
+    {},
+};
+
 static PyType_Spec Buffer_spec = {"Buffer", sizeof(Buffer), 0, Py_TPFLAGS_DEFAULT, Buffer_slots};
 static PyType_Spec Source_spec = {"Source", sizeof(Source), 0, Py_TPFLAGS_DEFAULT, Source_slots};
+static PyType_Spec Task_spec = {"Task", sizeof(Task), 0, Py_TPFLAGS_DEFAULT, Task_slots};
+static PyType_Spec Bank_spec = {"Bank", sizeof(Bank), 0, Py_TPFLAGS_DEFAULT, Bank_slots};
+static PyType_Spec Stream_spec = {"Stream", sizeof(Stream), 0, Py_TPFLAGS_DEFAULT, Stream_slots};
+static PyType_Spec OggStream_spec = {"OggStream", sizeof(DecodeStream), 0, Py_TPFLAGS_DEFAULT, DecodeStream_slots};
+static PyType_Spec QoaStream_spec = {"QoaStream", sizeof(DecodeStream), 0, Py_TPFLAGS_DEFAULT, DecodeStream_slots};
 
 static PyMethodDef module_methods[] = {
     {"init", (PyCFunction)meth_init, METH_VARARGS | METH_KEYWORDS},
     {"update", (PyCFunction)meth_update, METH_VARARGS | METH_KEYWORDS},
     {"pause", (PyCFunction)meth_pause, METH_NOARGS},
     {"resume", (PyCFunction)meth_resume, METH_NOARGS},
+    {"cache_stats", (PyCFunction)meth_cache_stats, METH_NOARGS},
     {"load", (PyCFunction)meth_load, METH_VARARGS | METH_KEYWORDS},
+    {"load_async", (PyCFunction)meth_load_async, METH_VARARGS | METH_KEYWORDS},
+    {"load_bank", (PyCFunction)meth_load_bank, METH_VARARGS | METH_KEYWORDS},
+    {"load_many", (PyCFunction)meth_load_many, METH_VARARGS | METH_KEYWORDS},
+    {"register", (PyCFunction)meth_register, METH_VARARGS | METH_KEYWORDS},
+    {"prefetch", (PyCFunction)meth_prefetch, METH_VARARGS | METH_KEYWORDS},
     {"unload", (PyCFunction)meth_unload, METH_VARARGS | METH_KEYWORDS},
     {"play", (PyCFunction)meth_play, METH_VARARGS | METH_KEYWORDS},
+    {"play_many", (PyCFunction)meth_play_many, METH_VARARGS | METH_KEYWORDS},
+    {"set_positions", (PyCFunction)meth_set_positions, METH_VARARGS | METH_KEYWORDS},
+    {"set_params", (PyCFunction)meth_set_params, METH_VARARGS | METH_KEYWORDS},
+    {"stream", (PyCFunction)meth_stream, METH_VARARGS | METH_KEYWORDS},
     {"qoa_decode", (PyCFunction)meth_qoa_decode, METH_VARARGS | METH_KEYWORDS},
     {"qoa_encode", (PyCFunction)meth_qoa_encode, METH_VARARGS | METH_KEYWORDS},
+    {"qoa_stream", (PyCFunction)meth_qoa_stream, METH_VARARGS | METH_KEYWORDS},
     {"ogg_decode", (PyCFunction)meth_ogg_decode, METH_VARARGS | METH_KEYWORDS},
+    {"ogg_stream", (PyCFunction)meth_ogg_stream, METH_VARARGS | METH_KEYWORDS},
     {},
 };
 
 static void module_free(void * module) {
-    if (device) {
-        alcCloseDevice(device);
-        device = NULL;
+    if (stream_thread) {
+        InterlockedExchange(&stream_quit, 1);
+        SetEvent(stream_wake);
+        WaitForSingleObject(stream_thread, INFINITE);
+        CloseHandle(stream_thread);
+        CloseHandle(stream_wake);
+        stream_thread = NULL;
+    }
+    reap_streams(true);
+    while (voices.count) {
+        reap_voice(voices.count - 1);
+    }
+    PyMem_Free(voices.source);
+    PyMem_Free(voices.buffer);
+    PyMem_Free(voices.object);
+    PyMem_Free(voices.state);
+    PyMem_Free(voices.priority);
+    if (use_events) {
+        int types[] = {AL_EVENT_TYPE_SOURCE_STATE_CHANGED_SOFT};
+        alEventControlSOFT(1, types, false);
+        PyMem_Free(stopped.items);
+        use_events = false;
+    }
+    PyMem_Free(source_keys);
+    PyMem_Free(source_voices);
+    if (source_pool) {
+        alDeleteSources(source_pool_size, source_pool);
+        PyMem_Free(source_pool);
+        source_pool = NULL;
     }
+    close_device();
 }
 
 static PyModuleDef module_def = {
@@ -501,9 +3635,19 @@ extern "C" PyObject * PyInit_soundbox() {
     }
 
     buffers = PyDict_New();
+    qoa_search = qoa_search_detect();
     Buffer_type = (PyTypeObject *)PyType_FromSpec(&Buffer_spec);
     Source_type = (PyTypeObject *)PyType_FromSpec(&Source_spec);
+    Task_type = (PyTypeObject *)PyType_FromSpec(&Task_spec);
+    Stream_type = (PyTypeObject *)PyType_FromSpec(&Stream_spec);
+    Bank_type = (PyTypeObject *)PyType_FromSpec(&Bank_spec);
+    OggStream_type = (PyTypeObject *)PyType_FromSpec(&OggStream_spec);
+    QoaStream_type = (PyTypeObject *)PyType_FromSpec(&QoaStream_spec);
     PyModule_AddObject(module, "Buffer", (PyObject *)Buffer_type);
     PyModule_AddObject(module, "Source", (PyObject *)Source_type);
+    PyModule_AddObject(module, "Task", (PyObject *)Task_type);
+    PyModule_AddObject(module, "Stream", (PyObject *)Stream_type);
+    PyModule_AddObject(module, "OggStream", (PyObject *)OggStream_type);
+    PyModule_AddObject(module, "QoaStream", (PyObject *)QoaStream_type);
     return module;
 }
@@ -1,4 +1,6 @@
+import mmap
 import os
+import struct
 
 
 def load(data, core):
@@ -6,16 +8,57 @@ def load(data, core):
         return data
 
     if isinstance(data, str):
-        with open(data, 'rb') as f:
-            data = f.read()
+        with open(data, 'rb') as f, mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) as m:
+            return load(m, core)
 
     decoder = {
         b'qoaf': core.qoa_decode,
         b'OggS': core.ogg_decode,
-    }[data[:4]]
+    }[bytes(memoryview(data).cast('B')[:4])]
 
     return decoder(data)
 
 
+def audio_info(data):
+    data = bytes(memoryview(data).cast('B')[:64])
+    if data[:4] == b'qoaf':
+        return 0, int.from_bytes(data[9:12], 'big'), data[8]
+    if data[:4] == b'OggS':
+        p = 27 + data[26]
+        if data[p:p + 7] == b'\x01vorbis':
+            return 1, int.from_bytes(data[p + 12:p + 16], 'little'), data[p + 11]
+    raise ValueError('unsupported audio format')
+
+
+def build_bank(path, assets):
+    entries = []
+    for name, data in assets.items():
+        if isinstance(data, str):
+            with open(data, 'rb') as f:
+                data = f.read()
+        entries.append((name.encode(), bytes(data)))
+
+    entries.sort()
+    names = b''.join(name for name, _ in entries)
+    offset = 16 + len(entries) * 32 + len(names)
+    name_offset = 0
+    payloads = {}
+    index = []
+
+    for name, data in entries:
+        codec, samplerate, channels = audio_info(data)
+        if data not in payloads:
+            payloads[data] = offset
+            offset += len(data)
+        index.append(struct.pack('<8I', name_offset, len(name), payloads[data], len(data), codec, samplerate, channels, 0))
+        name_offset += len(name)
+
+    with open(path, 'wb') as f:
+        f.write(struct.pack('<4s3I', b'SBNK', 1, len(entries), len(names)))
+        f.writelines(index)
+        f.write(names)
+        f.writelines(payloads)
+
+
 def find_openal():
     return os.path.abspath(os.path.normpath(os.path.join(os.path.dirname(__file__), 'soft_oal.dll')))